@@ -0,0 +1,96 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include "ray.hpp"
+
+/// @brief Class for axis-aligned bounding boxes.
+class aabb {
+    public:
+        interval x, y, z;
+
+        /// @brief Empty constructor, boxes start empty.
+        aabb() {}
+
+        /// @brief Constructor with the interval of each axis.
+        /// @param ix Interval in the x axis.
+        /// @param iy Interval in the y axis.
+        /// @param iz Interval in the z axis.
+        aabb(const interval& ix, const interval& iy, const interval& iz) : x(ix), y(iy), z(iz) {}
+
+        /// @brief Constructor for the box with two opposite corners.
+        /// @param a Corner A.
+        /// @param b Corner B.
+        aabb(const point3& a, const point3& b) {
+            x = interval(min_of(a[0], b[0]), max_of(a[0], b[0]));
+            y = interval(min_of(a[1], b[1]), max_of(a[1], b[1]));
+            z = interval(min_of(a[2], b[2]), max_of(a[2], b[2]));
+        }
+
+        /// @brief Constructor for the smallest box that encloses two boxes.
+        /// @param box0 Box A.
+        /// @param box1 Box B.
+        aabb(const aabb& box0, const aabb& box1) {
+            x = interval(box0.x, box1.x);
+            y = interval(box0.y, box1.y);
+            z = interval(box0.z, box1.z);
+        }
+
+        /// @brief Get the interval of an axis.
+        /// @param n Axis index.
+        /// @return Interval.
+        const interval& axis(int n) const {
+            if(n == 1) return y;
+            if(n == 2) return z;
+            return x;
+        }
+
+        /// @brief Get the center of the box.
+        /// @return Center point.
+        point3 center() const {
+            return point3(0.5 * (x.min + x.max), 0.5 * (y.min + y.max), 0.5 * (z.min + z.max));
+        }
+
+        /// @brief Get the surface area of the box, used by the surface area heuristic.
+        /// @return Surface area, zero for an empty box.
+        double surface_area() const {
+            if(x.size() < 0 || y.size() < 0 || z.size() < 0) return 0;
+            return 2 * (x.size() * y.size() + y.size() * z.size() + z.size() * x.size());
+        }
+
+        /// @brief Get a copy of the box in which no side is thinner than delta.
+        /// @param delta Minimum side.
+        /// @return Padded box.
+        aabb pad(double delta = 1e-4) const {
+            interval new_x = (x.size() >= delta) ? x : x.expand(delta);
+            interval new_y = (y.size() >= delta) ? y : y.expand(delta);
+            interval new_z = (z.size() >= delta) ? z : z.expand(delta);
+            return aabb(new_x, new_y, new_z);
+        }
+
+        /// @brief Decide if a ray hits the box with the slab method.
+        /// Uses the ray's precomputed inverse direction and min/max instead of
+        /// divisions and branches, so the three slabs are tested in straight-line code.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @return True if the ray hits the box inside the interval.
+        bool hit(const ray& r, interval ray_t) const {
+            const point3& orig = r.origin();
+            const vec3& inv_d = r.inv_direction();
+
+            double tx0 = (x.min - orig[0]) * inv_d[0], tx1 = (x.max - orig[0]) * inv_d[0];
+            double ty0 = (y.min - orig[1]) * inv_d[1], ty1 = (y.max - orig[1]) * inv_d[1];
+            double tz0 = (z.min - orig[2]) * inv_d[2], tz1 = (z.max - orig[2]) * inv_d[2];
+
+            double t_enter = max_of(max_of(min_of(tx0, tx1), min_of(ty0, ty1)), max_of(min_of(tz0, tz1), ray_t.min));
+            double t_exit = min_of(min_of(max_of(tx0, tx1), max_of(ty0, ty1)), min_of(max_of(tz0, tz1), ray_t.max));
+
+            return t_enter <= t_exit;
+        }
+
+    private:
+        // Plain comparisons compile to single min/max instructions, unlike fmin/fmax.
+        static double min_of(double a, double b) { return a < b ? a : b; }
+        static double max_of(double a, double b) { return a > b ? a : b; }
+};
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "hittable_list.hpp"
+#include "stats.hpp"
+
+#include <algorithm>
+
+/// @brief Node of a bounding volume hierarchy, split with the surface area heuristic (SAH).
+/// Each node holds two children (nodes or objects) and the box that encloses both,
+/// so a ray that misses the box skips everything under it. Small ranges of objects
+/// become leaves, lists of objects under the left child, when the SAH finds that
+/// cheaper than splitting them further.
+class bvh_node : public hittable {
+    public:
+        /// @brief Constructor for a hierarchy over all objects of a list.
+        /// @param list List of objects.
+        bvh_node(const hittable_list& list) : bvh_node(list.get_objects()) {}
+
+        /// @brief Constructor for a hierarchy over a set of objects.
+        /// @param objects Objects.
+        bvh_node(const std::vector<shared_ptr<hittable>>& objects) {
+            std::vector<build_entry> entries;
+            entries.reserve(objects.size());
+            for(const auto& object : objects) {
+                aabb box = object->bounding_box();
+                entries.push_back({object, box, box.center()});
+            }
+            build(entries, 0, entries.size());
+        }
+
+        /// @brief Finds the closest object under this node hit by a ray.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @param rec Hit record.
+        /// @return True if the ray hits some object.
+        bool intersect(const ray& r, interval ray_t, hit_record& rec) const override {
+            BVH_COUNT(nodes_visited);
+            if(!left || !bbox.hit(r, ray_t))
+                return false;
+
+            bool hit_left = intersect_child(*left, r, ray_t, rec);
+            bool hit_right = right && intersect_child(*right, r, interval(ray_t.min, hit_left ? rec.t : ray_t.max), rec);
+
+            return hit_left || hit_right;
+        }
+
+        /// @brief Decides if any object under this node blocks a ray.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @return True at the first object hit.
+        bool occluded(const ray& r, interval ray_t) const override {
+            BVH_COUNT(nodes_visited);
+            if(!left || !bbox.hit(r, ray_t))
+                return false;
+            return left->occluded(r, ray_t) || (right && right->occluded(r, ray_t));
+        }
+
+        /// @brief Get the node's bounding box.
+        /// @return Box that encloses both children.
+        aabb bounding_box() const override { return bbox; }
+
+    private:
+        // Object with its box and box center, computed once for the whole build.
+        struct build_entry {
+            shared_ptr<hittable> object;
+            aabb box;
+            point3 centroid;
+        };
+
+        // Leaves hold at most this many objects, in a list under the left child.
+        static const size_t max_leaf_size = 4;
+        // Cost of testing a node's children, relative to testing an object.
+        static constexpr double traversal_cost = 1.0;
+
+        shared_ptr<hittable> left; // Null only for an empty hierarchy.
+        shared_ptr<hittable> right; // Null for a leaf.
+        aabb bbox;
+
+        /// @brief Constructor for an inner node over a range of entries.
+        /// @param entries Build entries, reordered in place.
+        /// @param start First entry.
+        /// @param end Entry after the last one.
+        bvh_node(std::vector<build_entry>& entries, size_t start, size_t end) {
+            build(entries, start, end);
+        }
+
+        /// @brief Build this node over a range of entries.
+        /// @param entries Build entries, reordered in place.
+        /// @param start First entry.
+        /// @param end Entry after the last one.
+        void build(std::vector<build_entry>& entries, size_t start, size_t end) {
+            size_t span = end - start;
+
+            // An empty hierarchy keeps an empty box and no children.
+            if(span == 0)
+                return;
+            if(span == 1) {
+                left = entries[start].object;
+                bbox = entries[start].box;
+                return;
+            }
+            if(span == 2) {
+                left = entries[start].object;
+                right = entries[start + 1].object;
+                bbox = aabb(entries[start].box, entries[start + 1].box);
+                return;
+            }
+
+            // Try every split of the entries sorted by centroid along each axis and keep
+            // the one with the lowest cost, area(left) * count(left) + area(right) * count(right).
+            std::vector<double> right_area(span);
+            int best_axis = 0;
+            size_t best_split = span / 2;
+            double best_cost = infinity;
+
+            for(int axis = 0; axis < 3; axis++) {
+                sort_by_centroid(entries, start, end, axis);
+
+                aabb right_box;
+                for(size_t i = span - 1; i > 0; i--) {
+                    right_box = aabb(right_box, entries[start + i].box);
+                    right_area[i] = right_box.surface_area();
+                }
+
+                aabb left_box;
+                for(size_t i = 1; i < span; i++) {
+                    left_box = aabb(left_box, entries[start + i - 1].box);
+                    double cost = left_box.surface_area() * i + right_area[i] * (span - i);
+                    if(cost < best_cost) {
+                        best_cost = cost;
+                        best_axis = axis;
+                        best_split = i;
+                    }
+                }
+            }
+
+            // Keep small ranges as one leaf when testing all of their objects is cheaper than splitting,
+            // in units of the node's area like the costs above.
+            aabb box;
+            for(size_t i = start; i < end; i++)
+                box = aabb(box, entries[i].box);
+            double area = box.surface_area();
+            double split_cost = traversal_cost + (area > 0 ? best_cost / area : double(span));
+            if(span <= max_leaf_size && double(span) <= split_cost) {
+                auto leaf = make_shared<hittable_list>();
+                for(size_t i = start; i < end; i++)
+                    leaf->add(entries[i].object);
+                left = leaf;
+                bbox = box;
+                return;
+            }
+
+            if(best_axis != 2)
+                sort_by_centroid(entries, start, end, best_axis);
+
+            size_t mid = start + best_split;
+            left = shared_ptr<bvh_node>(new bvh_node(entries, start, mid));
+            right = shared_ptr<bvh_node>(new bvh_node(entries, mid, end));
+            bbox = aabb(left->bounding_box(), right->bounding_box());
+        }
+
+        /// @brief Sort a range of entries by the centroid of their boxes.
+        /// @param entries Build entries.
+        /// @param start First entry.
+        /// @param end Entry after the last one.
+        /// @param axis Axis to sort along.
+        static void sort_by_centroid(std::vector<build_entry>& entries, size_t start, size_t end, int axis) {
+            std::sort(entries.begin() + start, entries.begin() + end,
+                      [axis](const build_entry& a, const build_entry& b) {
+                          return a.centroid[axis] < b.centroid[axis];
+                      });
+        }
+};
+
+#endif
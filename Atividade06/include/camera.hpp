@@ -1,10 +1,16 @@
 #ifndef CAMERA_H
 #define CAMERA_H
 
-#include "CImg.h"
+#include "film.hpp"
 #include "material.hpp"
+#include "thread_pool.hpp"
+#include "wavefront.hpp"
 
-using namespace cimg_library;
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <numeric>
 
 /// @brief Class to render a world.
 class camera {
@@ -13,49 +19,120 @@ class camera {
     int img_width = 400; //!< Rendered image width in pixels.
     int samples_per_pixel = 10; //!< Number of random samples for each pixel.
     int max_depth = 10; //!< Maximum number of ray bounces.
+    int roulette_depth = 3; //!< Bounces after which Russian roulette may end a path (negative disables it).
     double vfov = 90; //!< Vertical field of view.
     point3 look_from = point3(0, 0, -1); //!< Where camera is looking from.
     point3 look_at = point3(0, 0, 0); //!< Where camera is looking at.
     vec3 v_up = vec3(0, 1, 0); //!< Camera-relative up direction.
     string path = "../images/output.png"; //!< Path to save image.
 
-    /// @brief Render world.
+    int num_threads = 0; //!< Number of render threads (0 uses all hardware threads).
+    int tile_size = 16; //!< Side in pixels of the square tiles the image is split into.
+    uint64_t seed = 0; //!< Base seed of the per-pixel random streams.
+    bool wavefront = false; //!< Trace all samples of a tile as one batch with the wavefront integrator.
+
+    bool progressive = false; //!< Render the whole frame one sample pass at a time.
+    int snapshot_passes = 0; //!< In progressive mode, save a preview every this many passes (0 disables).
+    double snapshot_seconds = 0; //!< In progressive mode, save a preview every this many seconds (0 disables).
+
+    bool adaptive = false; //!< Spend the sample budget on the pixels that are still noisy.
+    int min_samples = 8; //!< In adaptive mode, samples every pixel gets before its noise is estimated.
+    int max_samples = 0; //!< In adaptive mode, sample limit of a pixel (0 uses 4 * samples_per_pixel).
+    double noise_threshold = 0.01; //!< In adaptive mode, standard error (in gamma space) at which a pixel is converged.
+    int flat_samples = 16; //!< In adaptive mode, samples a pixel whose samples all agree needs before it is converged.
+
+    string checkpoint_path = ""; //!< File to checkpoint the accumulated samples to (empty disables).
+    double checkpoint_seconds = 600; //!< Time between checkpoints.
+
+    double time_budget = 0; //!< Wall-clock seconds to render for, instead of a fixed sample count (0 disables).
+
+    int crop_x = 0; //!< Left edge of the region of the frame to render.
+    int crop_y = 0; //!< Top edge of the region of the frame to render.
+    int crop_width = 0; //!< Width of the region of the frame to render (0 renders up to the right edge).
+    int crop_height = 0; //!< Height of the region of the frame to render (0 renders up to the bottom edge).
+    string film_path = ""; //!< File to also save the linear samples to, for merging partial renders (empty disables).
+
+    /// @brief Render world, splitting the image in tiles that are rendered in parallel.
     /// @param world World.
     void render(const hittable& world) {
         initialize();
+        run(world);
+    }
 
-        CImg<unsigned char> img(img_width, img_height, 1, 3, 255);
+    /// @brief Continue a render from the samples saved at checkpoint_path.
+    /// The camera must have the same settings as the render that wrote it.
+    /// @param world World.
+    void resume(const hittable& world) {
+        initialize();
 
-        for(int y = 0; y < img_height; ++y) {
-            for(int x = 0; x < img_width; ++x) {
-                color pixel_color(0, 0, 0);
+        uint64_t checkpoint_seed;
+        if(!accum.read(checkpoint_path, checkpoint_seed)) {
+            clog << "> Error reading checkpoint " << checkpoint_path << "!\n";
+            exit(1);
+        }
+        if(accum.width != x_end - x_begin || accum.height != y_end - y_begin ||
+           accum.x_offset != x_begin || accum.y_offset != y_begin || checkpoint_seed != seed) {
+            clog << "> Checkpoint " << checkpoint_path << " doesn't match this camera!\n";
+            exit(1);
+        }
 
-                for(int sample = 0; sample < samples_per_pixel; ++sample) {
-                    ray r = get_ray(x, y);
-                    // Sum colors of all samples.
-                    pixel_color += ray_color(r, max_depth, world); 
-                }
+        clog << "\rResuming from " << checkpoint_path << endl;
+        run(world);
+    }
 
-                // Get mean of color samples.
-                double r = pixel_color.x() / samples_per_pixel;
-                double g = pixel_color.y() / samples_per_pixel;
-                double b = pixel_color.z() / samples_per_pixel;
-
-                // Tranform data from linear to gamma 2 space.
-                r = sqrt(r);
-                g = sqrt(g);
-                b = sqrt(b);
-
-                // Ensure color values don't go beyond RGB bounds.
-                static const interval intensity(0.000, 0.999);
-                img(x, y, 0) = static_cast<int>(256 * intensity.clamp(r));
-                img(x, y, 1) = static_cast<int>(256 * intensity.clamp(g));
-                img(x, y, 2) = static_cast<int>(256 * intensity.clamp(b));
+    /// @brief Render several views of the same world, scheduling the tiles of all
+    /// cameras on one shared thread pool. Each image is saved as soon as its last
+    /// tile is done. Every camera takes its samples_per_pixel samples per pixel in a
+    /// single pass, so cameras set up for a mode that needs several passes (progressive,
+    /// adaptive, checkpoints or a time budget) are rejected.
+    /// @param cameras Cameras to render.
+    /// @param world World, prepared once and shared by all cameras.
+    /// @param num_threads Number of render threads (0 uses all hardware threads).
+    static void render_batch(const vector<camera*>& cameras, const hittable& world, int num_threads = 0) {
+        for(const camera* cam : cameras) {
+            if(cam->progressive || cam->adaptive || !cam->checkpoint_path.empty() || cam->time_budget > 0) {
+                clog << "> Error: camera for " << cam->path << " uses a multi-pass mode, "
+                     << "which batch rendering doesn't support!\n";
+                exit(1);
             }
         }
 
-        img.save(path.c_str());
-        clog << "\rGenerated image saved at " << path << endl;
+        auto start = chrono::steady_clock::now();
+        vector<atomic<int>> tiles_left(cameras.size());
+
+        for(size_t c = 0; c < cameras.size(); ++c) {
+            camera& cam = *cameras[c];
+            cam.initialize();
+            cam.start_clocks(start);
+            std::fill(cam.sample_goal.begin(), cam.sample_goal.end(), cam.samples_per_pixel);
+
+            tiles_left[c] = static_cast<int>(cam.tiles().size());
+        }
+
+        thread_pool pool(num_threads);
+        for(size_t c = 0; c < cameras.size(); ++c) {
+            camera* cam = cameras[c];
+            atomic<int>* left = &tiles_left[c];
+
+            for(auto [x0, y0] : cam->tiles()) {
+                pool.submit([cam, left, &world, &start, x0 = x0, y0 = y0] {
+                    cam->render_tile(x0, y0, world);
+
+                    // The worker that finishes the last tile saves the image.
+                    if(--(*left) == 0) {
+                        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+                        cam->save();
+                        clog << "\rGenerated image saved at " << cam->path << " after "
+                             << elapsed.count() << "s" << endl;
+                    }
+                });
+            }
+        }
+        pool.wait();
+
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        clog << "\rRendered " << cameras.size() << " views on " << pool.size()
+             << " threads in " << elapsed.count() << "s" << endl;
     }
 
   private:
@@ -65,12 +142,278 @@ class camera {
     vec3 pixel_delta_u; // Offset to pixel to the right.
     vec3 pixel_delta_v; // Offset to pixel below.
     vec3 u, v, w; // Camera positioning vectors.
+    int x_begin, y_begin, x_end, y_end; // Region of the frame being rendered.
+    film accum; // Accumulated samples of the render.
+    chrono::steady_clock::time_point last_checkpoint; // When the last checkpoint was written.
+    chrono::steady_clock::time_point deadline; // When a time budgeted render must stop.
+    vector<int> sample_goal; // Number of samples each pixel must have after the current pass.
+
+    /// @brief Render with the selected mode, starting from the samples already in the film.
+    /// @param world World.
+    void run(const hittable& world) {
+        auto start = chrono::steady_clock::now();
+        start_clocks(start);
+        thread_pool pool(num_threads);
+
+        if(adaptive)
+            render_adaptive(world, pool);
+        else if(progressive || !checkpoint_path.empty() || time_budget > 0)
+            render_progressive(world, pool); // Same image, with room for checkpoints between passes.
+        else
+            render_pass(world, pool, samples_per_pixel);
+
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        clog << "\rRendered " << x_end - x_begin << "x" << y_end - y_begin << " on " << pool.size()
+             << " threads in " << elapsed.count() << "s" << endl;
+        if(time_budget > 0) {
+            double mean_samples = std::accumulate(accum.samples.begin(), accum.samples.end(), 0.0)
+                                  / accum.samples.size();
+            clog << "\rTime budget of " << time_budget << "s gave " << mean_samples
+                 << " samples per pixel on average" << endl;
+        }
+
+        save();
+        clog << "\rGenerated image saved at " << path << endl;
+    }
+
+    /// @brief Start the checkpoint and time budget clocks.
+    /// @param start When the render started.
+    void start_clocks(chrono::steady_clock::time_point start) {
+        last_checkpoint = start;
+        deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(
+            chrono::duration<double>(time_budget));
+    }
+
+    /// @brief Save the image and, if requested, the linear samples for merging.
+    void save() const {
+        accum.save(path);
+        if(!film_path.empty() && !accum.write(film_path, seed))
+            clog << "\r> Error writing film " << film_path << "!\n";
+    }
+
+    /// @brief Get the tiles of the region being rendered.
+    /// @return Coordinates of the upper left pixel of each tile.
+    vector<pair<int, int>> tiles() const {
+        vector<pair<int, int>> origins;
+        for(int y0 = y_begin; y0 < y_end; y0 += tile_size)
+            for(int x0 = x_begin; x0 < x_end; x0 += tile_size)
+                origins.push_back({x0, y0});
+        return origins;
+    }
+
+    /// @brief Check if a time budgeted render ran out of time.
+    /// @return True if the deadline has passed.
+    bool out_of_time() const {
+        return time_budget > 0 && chrono::steady_clock::now() >= deadline;
+    }
+
+    /// @brief Write a checkpoint if checkpoint_seconds have passed since the last one.
+    void checkpoint() {
+        if(checkpoint_path.empty()) return;
+
+        chrono::duration<double> since_checkpoint = chrono::steady_clock::now() - last_checkpoint;
+        if(since_checkpoint.count() < checkpoint_seconds) return;
+
+        if(accum.write(checkpoint_path, seed))
+            clog << "\rCheckpoint saved at " << checkpoint_path << flush;
+        else
+            clog << "\r> Error writing checkpoint " << checkpoint_path << "!\n";
+        last_checkpoint = chrono::steady_clock::now();
+    }
+
+    /// @brief Render the frame one sample per pixel at a time, saving previews along the way.
+    /// With a time budget, passes go on until the deadline instead of samples_per_pixel.
+    /// @param world World.
+    /// @param pool Render threads.
+    void render_progressive(const hittable& world, thread_pool& pool) {
+        auto last_snapshot = chrono::steady_clock::now();
+
+        int done = *std::min_element(accum.samples.begin(), accum.samples.end());
+        int passes = (time_budget > 0) ? std::numeric_limits<int>::max() : samples_per_pixel;
+
+        for(int pass = done; pass < passes; ++pass) {
+            render_pass(world, pool, pass + 1);
+            checkpoint();
+
+            if(pass + 1 == passes || out_of_time()) break;
+
+            chrono::duration<double> since_snapshot = chrono::steady_clock::now() - last_snapshot;
+            bool passes_due = snapshot_passes > 0 && (pass + 1) % snapshot_passes == 0;
+            bool time_due = snapshot_seconds > 0 && since_snapshot.count() >= snapshot_seconds;
+
+            if(passes_due || time_due) {
+                accum.save(path);
+                last_snapshot = chrono::steady_clock::now();
+                clog << "\rPreview after " << pass + 1 << " passes saved at " << path << flush;
+            }
+        }
+    }
+
+    /// @brief Sample the noisy pixels until they converge or the budget of
+    /// samples_per_pixel samples per pixel (on average), or the time budget, runs out.
+    /// @param world World.
+    /// @param pool Render threads.
+    void render_adaptive(const hittable& world, thread_pool& pool) {
+        int first_samples = std::min(std::max(2, min_samples), samples_per_pixel);
+        int limit = (max_samples > 0) ? max_samples : 4 * samples_per_pixel;
+        long long budget = static_cast<long long>(samples_per_pixel) * accum.samples.size();
+        if(time_budget > 0) budget = std::numeric_limits<long long>::max();
+
+        render_pass(world, pool, first_samples);
+        checkpoint();
+        long long used = std::accumulate(accum.samples.begin(), accum.samples.end(), 0LL);
+
+        while(used < budget && !out_of_time()) {
+            // Find the pixels that are still above the noise threshold. Samples that all agree
+            // give zero error, which only counts once there are enough of them to trust it.
+            vector<pair<double, size_t>> noisy;
+            for(size_t i = 0; i < sample_goal.size(); ++i) {
+                int n = accum.samples[i];
+                double error = accum.error(i);
+                bool converged = n >= min_samples && error <= noise_threshold && (error > 0 || n >= flat_samples);
+                if(n < limit && !converged)
+                    noisy.push_back({error, i});
+            }
+            if(noisy.empty()) break;
+
+            // If the budget can't cover all of them, favor the noisiest.
+            long long remaining = budget - used;
+            if(static_cast<long long>(noisy.size()) > remaining) {
+                std::nth_element(noisy.begin(), noisy.begin() + remaining, noisy.end(),
+                                 std::greater<pair<double, size_t>>());
+                noisy.resize(remaining);
+            }
+
+            int step = static_cast<int>(std::min<long long>(first_samples, remaining / noisy.size()));
+            for(const auto& [error, i] : noisy) {
+                int n = std::min(step, limit - accum.samples[i]);
+                sample_goal[i] = accum.samples[i] + n;
+                used += n;
+            }
+
+            render_tiles(world, pool);
+            checkpoint();
+        }
+
+        if(time_budget <= 0)
+            clog << "\rAdaptive sampling traced " << used << " camera rays ("
+                 << 100.0 * used / budget << "% of the fixed budget)" << endl;
+    }
+
+    /// @brief Bring every pixel up to the same number of samples, tile by tile.
+    /// @param world World.
+    /// @param pool Render threads.
+    /// @param goal Number of samples each pixel must have.
+    void render_pass(const hittable& world, thread_pool& pool, int goal) {
+        std::fill(sample_goal.begin(), sample_goal.end(), goal);
+        render_tiles(world, pool);
+    }
+
+    /// @brief Bring every pixel up to its sample goal, tile by tile.
+    /// @param world World.
+    /// @param pool Render threads.
+    void render_tiles(const hittable& world, thread_pool& pool) {
+        for(auto [x0, y0] : tiles())
+            pool.submit([this, &world, x0 = x0, y0 = y0] { render_tile(x0, y0, world); });
+        pool.wait();
+    }
+
+    /// @brief Bring every pixel of a tile up to its sample goal.
+    /// @param x0 X coordinate of the tile's upper left pixel.
+    /// @param y0 Y coordinate of the tile's upper left pixel.
+    /// @param world World.
+    void render_tile(int x0, int y0, const hittable& world) {
+        int x1 = std::min(x0 + tile_size, x_end);
+        int y1 = std::min(y0 + tile_size, y_end);
+
+        if(wavefront) {
+            render_tile_wavefront(x0, y0, x1, y1, world);
+            return;
+        }
+
+        for(int y = y0; y < y1; ++y) {
+            for(int x = x0; x < x1; ++x) {
+                size_t i = accum.index(x, y);
+
+                // Past the deadline, only pixels without any sample are still rendered.
+                if(accum.samples[i] > 0 && out_of_time()) continue;
+
+                for(int sample = accum.samples[i]; sample < sample_goal[i]; ++sample) {
+                    // Each sample has its own stream, independent from thread scheduling.
+                    seed_sample_stream(seed, pixel_index(x, y), sample);
+                    ray r = get_ray(x, y);
+                    // Tiles don't overlap, so each pixel is only written by one thread.
+                    accum.add(i, ray_color(r, max_depth, world));
+                }
+            }
+        }
+    }
+
+    /// @brief Bring every pixel of a tile up to its sample goal, tracing all of its
+    /// samples together with the wavefront integrator.
+    /// @param x0 X coordinate of the tile's upper left pixel.
+    /// @param y0 Y coordinate of the tile's upper left pixel.
+    /// @param x1 X coordinate after the tile's right edge.
+    /// @param y1 Y coordinate after the tile's bottom edge.
+    /// @param world World.
+    void render_tile_wavefront(int x0, int y0, int x1, int y1, const hittable& world) {
+        // Keep one integrator per thread so its buffers are reused across tiles.
+        static thread_local wavefront_integrator integrator;
+
+        // Past the deadline, only tiles with pixels without any sample are still rendered.
+        if(out_of_time()) {
+            bool sampled = true;
+            for(int y = y0; y < y1; ++y)
+                for(int x = x0; x < x1; ++x)
+                    sampled = sampled && accum.samples[accum.index(x, y)] > 0;
+            if(sampled) return;
+        }
+
+        integrator.max_depth = max_depth;
+        integrator.roulette_depth = roulette_depth;
+
+        vector<path_state> paths;
+        for(int y = y0; y < y1; ++y) {
+            for(int x = x0; x < x1; ++x) {
+                size_t i = accum.index(x, y);
+
+                for(int sample = accum.samples[i]; sample < sample_goal[i]; ++sample) {
+                    seed_sample_stream(seed, pixel_index(x, y), sample);
+                    path_state path;
+                    path.r = get_ray(x, y);
+                    path.rng = thread_rng();
+                    paths.push_back(path);
+                }
+            }
+        }
+
+        integrator.trace(paths, world);
+
+        // Paths were generated in pixel and sample order, add them back the same way.
+        size_t k = 0;
+        for(int y = y0; y < y1; ++y) {
+            for(int x = x0; x < x1; ++x) {
+                size_t i = accum.index(x, y);
+                for(int n = sample_goal[i] - accum.samples[i]; n > 0; --n)
+                    accum.add(i, paths[k++].result);
+            }
+        }
+    }
 
     /// @brief Initialize camera parameters.
     void initialize() {
         img_height = static_cast<int>(img_width / aspect_ratio);
         img_height = (img_height < 1) ? 1 : img_height;
 
+        // Clamp the crop window to the frame.
+        x_begin = std::clamp(crop_x, 0, img_width - 1);
+        y_begin = std::clamp(crop_y, 0, img_height - 1);
+        x_end = (crop_width > 0) ? std::min(x_begin + crop_width, img_width) : img_width;
+        y_end = (crop_height > 0) ? std::min(y_begin + crop_height, img_height) : img_height;
+
+        accum.reset(x_end - x_begin, y_end - y_begin, x_begin, y_begin, img_width, img_height);
+        sample_goal.assign(accum.sum.size(), 0);
+
         camera_center = look_from;
 
         // Determine viewport dimensions.
@@ -97,6 +440,14 @@ class camera {
         origin_pixel = view_upper_left + 0.5*(pixel_delta_u + pixel_delta_v);
     }
 
+    /// @brief Get the index of a pixel, used to select its random stream.
+    /// @param x X pixel coordinate.
+    /// @param y Y pixel coordinate.
+    /// @return Pixel index.
+    uint64_t pixel_index(int x, int y) const {
+        return static_cast<uint64_t>(y) * img_width + x;
+    }
+
     /// @brief Get a randomly sampled camera ray for the pixel at (x, y).
     /// @param x X pixel coodinate.
     /// @param y Y pixel coordinate.
@@ -114,33 +465,47 @@ class camera {
     /// @brief Move a pixel to a random point around him.
     /// @return Random pixel movement.
     vec3 pixel_random_nudge() const {
-        auto px = -0.5 + random_double();
-        auto py = -0.5 + random_double();
+        double u[2];
+        random_doubles(u, 2);
+        auto px = -0.5 + u[0];
+        auto py = -0.5 + u[1];
         return (px * pixel_delta_u) + (py * pixel_delta_v);
     }
 
-    /// @brief Draw color of pixel hit by ray.
+    /// @brief Draw color of pixel hit by ray, following its path bounce by bounce.
     /// @param r Ray.
+    /// @param depth Maximum number of bounces.
     /// @param world World.
     /// @return Pixel color.
     color ray_color(const ray& r, int depth, const hittable& world) const {
         hit_record rec;
+        ray current = r;
+        color throughput(1, 1, 1); // Fraction of light carried back along the path so far.
 
-        // If we've exceeded the ray bounce limit, no more light is gathered.
-        if(depth <= 0) return color(0,0,0);
+        for(int bounce = 0; bounce < depth; ++bounce) {
+            if(!world.hit(current, interval(0.001, infinity), rec))
+                return throughput * sky_color(current);
 
-        if(world.hit(r, interval(0.001, infinity), rec)) {
             ray scattered;
             color attenuation;
-            if (rec.mat->scatter(r, rec, attenuation, scattered))
-                return attenuation * ray_color(scattered, depth - 1, world);
-            return color(0, 0, 0);
-        }
+            if(!rec.mat->scatter(current, rec, attenuation, scattered))
+                return color(0, 0, 0);
+
+            throughput = throughput * attenuation;
+            current = scattered;
 
+            // Russian roulette: end low-contribution paths early, boosting the
+            // survivors by the inverse of their survival probability to stay unbiased.
+            if(roulette_depth >= 0 && bounce >= roulette_depth) {
+                double survival = fmin(0.95, fmax(throughput.x(), fmax(throughput.y(), throughput.z())));
+                if(random_double() >= survival)
+                    return color(0, 0, 0);
+                throughput /= survival;
+            }
+        }
 
-        vec3 unit_direction = unit_vector(r.direction());
-        double a = 0.5 * (unit_direction.y() + 1.0);
-        return (1.0 - a)*color(1.0, 1.0, 1.0) + a*color(0.5, 0.7, 1.0);
+        // If we've exceeded the ray bounce limit, no more light is gathered.
+        return color(0, 0, 0);
     }
 };
 
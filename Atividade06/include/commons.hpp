@@ -8,7 +8,8 @@
 #include <cmath>
 #include <limits>
 #include <memory>
-#include <random>
+
+#include "rng.hpp"
 
 // Usings
 using std::shared_ptr;
@@ -26,12 +27,10 @@ inline double degrees_to_radians(double degrees) {
     return degrees * pi / 180.0;
 }
 
-/// @brief Get a random real number in [0, 1).
+/// @brief Get a random real number in [0, 1) from the calling thread's generator.
 /// @return Random real number.
 inline double random_double() {
-    static std::uniform_real_distribution<double> distribution(0.0, 1.0);
-    static std::mt19937 generator;
-    return distribution(generator);
+    return thread_rng().next_double();
 }
 
 /// @brief Get a random real number in [min, max).
@@ -39,9 +38,14 @@ inline double random_double() {
 /// @param max Maximum value.
 /// @return Random real number.
 inline double random_double(double min, double max) {
-    static std::uniform_real_distribution<double> distribution(min, max);
-    static std::mt19937 generator;
-    return distribution(generator);
+    return min + (max - min) * random_double();
+}
+
+/// @brief Fill a buffer with random real numbers in [0, 1).
+/// @param out Buffer.
+/// @param n Number of values.
+inline void random_doubles(double* out, size_t n) {
+    thread_rng().fill(out, n);
 }
 
 // Common headers
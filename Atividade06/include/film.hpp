@@ -0,0 +1,233 @@
+#ifndef FILM_H
+#define FILM_H
+
+#include "CImg.h"
+#include "ray.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace cimg_library;
+
+/// @brief Linear floating-point accumulation buffer of a render.
+/// Keeps the sum of the samples and the number of samples of each pixel,
+/// so the image can be resolved at any point of the render. A film may cover
+/// only a region of the full frame, in which case pixels are still addressed
+/// by their full frame coordinates.
+class film {
+    public:
+        /// @brief Get the luminance of a linear color.
+        /// @param c Color.
+        /// @return Luminance.
+        static double luminance(const color& c) {
+            return 0.2126 * c.x() + 0.7152 * c.y() + 0.0722 * c.z();
+        }
+
+        static constexpr char checkpoint_magic[8] = {'R', 'T', 'F', 'I', 'L', 'M', '0', '2'};
+
+        int width = 0; //!< Width in pixels.
+        int height = 0; //!< Height in pixels.
+        int x_offset = 0; //!< X coordinate of the film's upper left pixel in the full frame.
+        int y_offset = 0; //!< Y coordinate of the film's upper left pixel in the full frame.
+        int full_width = 0; //!< Width of the full frame in pixels.
+        int full_height = 0; //!< Height of the full frame in pixels.
+        std::vector<color> sum; //!< Sum of the sampled colors of each pixel.
+        std::vector<double> sum_sq; //!< Sum of the squared luminance of the samples of each pixel.
+        std::vector<int> samples; //!< Number of samples of each pixel.
+
+        /// @brief Empty constructor.
+        film() {}
+
+        /// @brief Constructor for a cleared film that covers the full frame.
+        /// @param _width Width in pixels.
+        /// @param _height Height in pixels.
+        film(int _width, int _height) { reset(_width, _height); }
+
+        /// @brief Resize and clear the film.
+        /// @param _width Width in pixels.
+        /// @param _height Height in pixels.
+        /// @param _x_offset X coordinate of the upper left pixel in the full frame.
+        /// @param _y_offset Y coordinate of the upper left pixel in the full frame.
+        /// @param _full_width Width of the full frame (0 means the film covers it).
+        /// @param _full_height Height of the full frame (0 means the film covers it).
+        void reset(int _width, int _height, int _x_offset = 0, int _y_offset = 0,
+                   int _full_width = 0, int _full_height = 0) {
+            width = _width;
+            height = _height;
+            x_offset = _x_offset;
+            y_offset = _y_offset;
+            full_width = (_full_width > 0) ? _full_width : width;
+            full_height = (_full_height > 0) ? _full_height : height;
+            sum.assign(static_cast<size_t>(width) * height, color(0, 0, 0));
+            sum_sq.assign(static_cast<size_t>(width) * height, 0);
+            samples.assign(static_cast<size_t>(width) * height, 0);
+        }
+
+        /// @brief Get the index of a pixel in the film's buffers.
+        /// @param x X pixel coordinate in the full frame.
+        /// @param y Y pixel coordinate in the full frame.
+        /// @return Pixel index.
+        size_t index(int x, int y) const {
+            return static_cast<size_t>(y - y_offset) * width + (x - x_offset);
+        }
+
+        /// @brief Add a sample to a pixel.
+        /// @param i Pixel index.
+        /// @param c Sampled color.
+        void add(size_t i, const color& c) {
+            double l = luminance(c);
+            sum[i] += c;
+            sum_sq[i] += l * l;
+            samples[i] += 1;
+        }
+
+        /// @brief Get the mean color of a pixel.
+        /// @param i Pixel index.
+        /// @return Mean of the samples, black if there are none.
+        color mean(size_t i) const {
+            if(samples[i] == 0) return color(0, 0, 0);
+            return sum[i] / samples[i];
+        }
+
+        /// @brief Estimate the noise of a pixel as the standard error of its mean luminance,
+        /// scaled to gamma 2 space so dark and bright pixels are judged like they are displayed.
+        /// @param i Pixel index.
+        /// @return Estimated error, infinity if there are less than two samples.
+        double error(size_t i) const {
+            int n = samples[i];
+            if(n < 2) return infinity;
+
+            double mean_l = luminance(sum[i]) / n;
+            double variance = fmax(0.0, (sum_sq[i] - n * mean_l * mean_l) / (n - 1));
+            double std_error = sqrt(variance / n);
+
+            // d(sqrt(l)) = dl / (2 * sqrt(l)).
+            return std_error / (2 * sqrt(fmax(mean_l, 1e-4)));
+        }
+
+        /// @brief Resolve the film to an 8-bit gamma corrected image.
+        /// @return Image.
+        CImg<unsigned char> image() const {
+            CImg<unsigned char> img(width, height, 1, 3, 255);
+
+            for(int y = 0; y < height; ++y) {
+                for(int x = 0; x < width; ++x) {
+                    color pixel_color = mean(static_cast<size_t>(y) * width + x);
+
+                    // Tranform data from linear to gamma 2 space.
+                    double r = sqrt(pixel_color.x());
+                    double g = sqrt(pixel_color.y());
+                    double b = sqrt(pixel_color.z());
+
+                    // Ensure color values don't go beyond RGB bounds.
+                    static const interval intensity(0.000, 0.999);
+                    img(x, y, 0) = static_cast<int>(256 * intensity.clamp(r));
+                    img(x, y, 1) = static_cast<int>(256 * intensity.clamp(g));
+                    img(x, y, 2) = static_cast<int>(256 * intensity.clamp(b));
+                }
+            }
+
+            return img;
+        }
+
+        /// @brief Copy the pixels of a film that covers a region of the same frame into this one.
+        /// @param part Film of the region.
+        /// @return True if the region fits inside this film.
+        bool paste(const film& part) {
+            if(part.x_offset < x_offset || part.y_offset < y_offset ||
+               part.x_offset + part.width > x_offset + width ||
+               part.y_offset + part.height > y_offset + height)
+                return false;
+
+            for(int y = 0; y < part.height; ++y) {
+                for(int x = 0; x < part.width; ++x) {
+                    size_t j = static_cast<size_t>(y) * part.width + x;
+                    size_t i = index(part.x_offset + x, part.y_offset + y);
+                    sum[i] = part.sum[j];
+                    sum_sq[i] = part.sum_sq[j];
+                    samples[i] = part.samples[j];
+                }
+            }
+            return true;
+        }
+
+        /// @brief Write the raw accumulation buffers (linear colors, squared luminance and
+        /// sample counts) to a checkpoint file. The file is written next to its final path
+        /// and then renamed over it, so a crash never leaves a half-written checkpoint.
+        /// @param path Path of the checkpoint file.
+        /// @param seed Base seed of the render, which with the sample counts fixes the random streams.
+        /// @return True if the checkpoint was written.
+        bool write(const std::string& path, uint64_t seed) const {
+            std::string tmp_path = path + ".tmp";
+            {
+                std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+                if(!file.is_open()) return false;
+
+                int32_t size[6] = {width, height, x_offset, y_offset, full_width, full_height};
+                file.write(checkpoint_magic, sizeof(checkpoint_magic));
+                file.write(reinterpret_cast<const char*>(size), sizeof(size));
+                file.write(reinterpret_cast<const char*>(&seed), sizeof(seed));
+                file.write(reinterpret_cast<const char*>(sum.data()), sum.size() * sizeof(color));
+                file.write(reinterpret_cast<const char*>(sum_sq.data()), sum_sq.size() * sizeof(double));
+                file.write(reinterpret_cast<const char*>(samples.data()), samples.size() * sizeof(int));
+
+                // Closing flushes the last buffered bytes, which can fail too.
+                file.close();
+                if(file.fail()) {
+                    std::remove(tmp_path.c_str());
+                    return false;
+                }
+            }
+            return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+        }
+
+        /// @brief Read the raw accumulation buffers from a checkpoint file.
+        /// @param path Path of the checkpoint file.
+        /// @param seed Base seed of the render that wrote the checkpoint.
+        /// @return True if the checkpoint was read.
+        bool read(const std::string& path, uint64_t& seed) {
+            std::ifstream file(path, std::ios::binary);
+            if(!file.is_open()) return false;
+
+            char magic[sizeof(checkpoint_magic)];
+            int32_t size[6];
+            file.read(magic, sizeof(magic));
+            file.read(reinterpret_cast<char*>(size), sizeof(size));
+            file.read(reinterpret_cast<char*>(&seed), sizeof(seed));
+            if(!file.good() || std::memcmp(magic, checkpoint_magic, sizeof(magic)) != 0)
+                return false;
+
+            // Reject sizes that don't describe a region of the frame before allocating for them.
+            int32_t w = size[0], h = size[1], x0 = size[2], y0 = size[3], fw = size[4], fh = size[5];
+            if(w <= 0 || h <= 0 || x0 < 0 || y0 < 0 || fw <= 0 || fh <= 0 ||
+               int64_t(x0) + w > fw || int64_t(y0) + h > fh)
+                return false;
+
+            // And buffers longer than what is left of the file, like those of a truncated one.
+            std::streampos data_start = file.tellg();
+            file.seekg(0, std::ios::end);
+            std::streamoff remaining = file.tellg() - data_start;
+            file.seekg(data_start);
+            uint64_t pixels = uint64_t(w) * uint64_t(h);
+            if(!file.good() || remaining < 0 || pixels * (sizeof(color) + sizeof(double) + sizeof(int)) != uint64_t(remaining))
+                return false;
+
+            reset(size[0], size[1], size[2], size[3], size[4], size[5]);
+            file.read(reinterpret_cast<char*>(sum.data()), sum.size() * sizeof(color));
+            file.read(reinterpret_cast<char*>(sum_sq.data()), sum_sq.size() * sizeof(double));
+            file.read(reinterpret_cast<char*>(samples.data()), samples.size() * sizeof(int));
+            return file.good();
+        }
+
+        /// @brief Save the resolved image.
+        /// @param path Path to save image.
+        void save(const std::string& path) const {
+            image().save(path.c_str());
+        }
+};
+
+#endif
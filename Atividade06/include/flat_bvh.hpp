@@ -0,0 +1,794 @@
+#ifndef FLAT_BVH_H
+#define FLAT_BVH_H
+
+#include "hittable_list.hpp"
+#include "stats.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <unordered_set>
+#include <vector>
+
+/// @brief Round a double to the largest float not above it.
+/// @param v Value.
+/// @return Rounded value.
+inline float round_down(double v) {
+    float f = float(v);
+    return (double(f) > v) ? std::nextafter(f, -std::numeric_limits<float>::infinity()) : f;
+}
+
+/// @brief Round a double to the smallest float not below it.
+/// @param v Value.
+/// @return Rounded value.
+inline float round_up(double v) {
+    float f = float(v);
+    return (double(f) < v) ? std::nextafter(f, std::numeric_limits<float>::infinity()) : f;
+}
+
+/// @brief Node of a flattened hierarchy, 32 bytes so that two share a cache line.
+/// Nodes are stored in depth-first order: the first child of an inner node is the
+/// next node in the array and only the second one needs an offset.
+struct alignas(32) flat_bvh_node {
+    float lo[3]; //!< Box minimum, rounded down from the double precision box.
+    float hi[3]; //!< Box maximum, rounded up from the double precision box.
+    uint32_t offset; //!< Leaf: first primitive position. Inner node: index of the second child.
+    uint16_t count; //!< Number of primitives of a leaf, zero for inner nodes.
+    uint8_t axis; //!< Split axis of an inner node.
+    uint8_t pad; //!< Unused.
+};
+
+static_assert(sizeof(flat_bvh_node) == 32, "flat_bvh_node should be 32 bytes");
+
+/// @brief Bounding volume hierarchy over a set of boxes, stored as one flat array of nodes.
+/// The tree only knows boxes, so it can index any kind of primitive: each leaf covers
+/// a contiguous run of positions in prim_indices and the owner of the primitives is
+/// expected to store them in that order.
+class bvh_tree {
+    friend class sbvh_builder;
+
+    public:
+        std::vector<flat_bvh_node> nodes; //!< Nodes in depth-first order, the root first.
+        std::vector<uint32_t> prim_indices; //!< Original index of the primitive at each position.
+        int max_leaf_size = 4; //!< Maximum number of primitives in a leaf.
+
+        /// @brief Build the hierarchy with the binned surface area heuristic (SAH).
+        /// Large inputs are built in parallel: the top levels are split on the calling
+        /// thread with the binning spread over the workers, and the subtrees below them
+        /// are built as independent tasks and then spliced into depth-first order.
+        /// @param boxes Box of each primitive.
+        /// @param num_threads Number of build threads for large inputs (0 uses all hardware threads).
+        void build(const std::vector<aabb>& boxes, int num_threads = 0) {
+            nodes.clear();
+            prim_indices.resize(boxes.size());
+            std::iota(prim_indices.begin(), prim_indices.end(), 0);
+            if(boxes.empty()) return;
+
+            if(boxes.size() < parallel_threshold) {
+                bin_set scratch;
+                build_node(boxes, 0, boxes.size(), 0, nodes, scratch);
+                nodes.shrink_to_fit();
+                return;
+            }
+
+            thread_pool pool(num_threads);
+            size_t grain = std::max(parallel_threshold / 4, boxes.size() / (8 * pool.size()));
+
+            std::vector<top_node> top;
+            std::vector<subtree_job> jobs;
+            build_top(boxes, 0, boxes.size(), 0, grain, pool, top, jobs);
+
+            // Largest subtrees first, so that no big one is left alone at the end.
+            std::vector<size_t> order(jobs.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&jobs](size_t a, size_t b) {
+                return jobs[a].end - jobs[a].start > jobs[b].end - jobs[b].start;
+            });
+            for(size_t j : order) {
+                subtree_job* job = &jobs[j];
+                pool.submit([this, &boxes, job] {
+                    bin_set scratch;
+                    build_node(boxes, job->start, job->end, job->depth, job->nodes, scratch);
+                });
+            }
+            pool.wait();
+
+            size_t total = top.size();
+            for(const subtree_job& job : jobs) total += job.nodes.size();
+            nodes.reserve(total);
+            splice(top, jobs, 0);
+        }
+
+        /// @brief Update the node boxes after the primitives moved, keeping the tree's topology.
+        /// Children always come after their parent in depth-first order, so one reverse pass
+        /// over the nodes refits them bottom-up. Large trees refit disjoint subtrees, which
+        /// are contiguous runs of nodes, in parallel and then the few nodes above them.
+        /// @param boxes Box of each primitive, indexed like in build.
+        /// @param num_threads Number of threads for large trees (0 uses all hardware threads).
+        void refit(const std::vector<aabb>& boxes, int num_threads = 0) {
+            if(nodes.empty()) return;
+            if(nodes.size() < parallel_threshold) {
+                refit_range(boxes, 0, nodes.size());
+                return;
+            }
+
+            thread_pool pool(num_threads);
+
+            // Split the top of the tree level by level until there are enough subtrees.
+            std::vector<uint32_t> roots = {0}, above;
+            while(roots.size() < size_t(8 * pool.size())) {
+                std::vector<uint32_t> next;
+                for(uint32_t i : roots) {
+                    if(nodes[i].count > 0) {
+                        next.push_back(i);
+                    } else {
+                        above.push_back(i);
+                        next.push_back(i + 1);
+                        next.push_back(nodes[i].offset);
+                    }
+                }
+                if(next.size() == roots.size()) break;
+                roots.swap(next);
+            }
+
+            for(uint32_t root : roots)
+                pool.submit([this, &boxes, root] { refit_range(boxes, root, subtree_end(root)); });
+            pool.wait();
+
+            std::sort(above.begin(), above.end(), std::greater<uint32_t>());
+            for(uint32_t i : above)
+                refit_node(boxes, i);
+        }
+
+        /// @brief Walk the nodes hit by a ray and hand every primitive of the leaves to a callback.
+        /// The nearer child is visited first, so that a hit shrinks the interval before
+        /// the farther one is tested.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @param hit_prim Callback bool(uint32_t position, interval& ray_t) that tests the primitive
+        /// at a position and, when it is hit, lowers ray_t.max to the hit distance.
+        /// @return True if the callback reported some hit.
+        /// @tparam any_hit Return at the first hit reported, for occlusion queries.
+        template <bool any_hit = false, class F>
+        bool traverse(const ray& r, interval ray_t, F&& hit_prim) const {
+            if(nodes.empty()) return false;
+
+            const point3& orig = r.origin();
+            const vec3& inv_d = r.inv_direction();
+            // The origin rounded both ways, see hit_node.
+            const float o_lo[3] = {round_down(orig[0]), round_down(orig[1]), round_down(orig[2])};
+            const float o_hi[3] = {round_up(orig[0]), round_up(orig[1]), round_up(orig[2])};
+            const float inv[3] = {float(inv_d[0]), float(inv_d[1]), float(inv_d[2])};
+            const bool negative[3] = {inv_d[0] < 0, inv_d[1] < 0, inv_d[2] < 0};
+
+            bool hit_anything = false;
+            uint32_t stack[stack_size];
+            int top = 0;
+            uint32_t current = 0;
+
+            while(true) {
+                const flat_bvh_node& node = nodes[current];
+                BVH_COUNT(nodes_visited);
+
+                if(hit_node(node, o_lo, o_hi, inv, round_down(ray_t.min), round_up(ray_t.max))) {
+                    if(node.count > 0) {
+                        for(uint32_t p = node.offset; p < node.offset + node.count; p++) {
+                            BVH_COUNT(primitives_tested);
+                            if(hit_prim(p, ray_t)) {
+                                if(any_hit) return true;
+                                hit_anything = true;
+                            }
+                        }
+                    } else if(negative[node.axis]) {
+                        stack[top++] = current + 1;
+                        current = node.offset;
+                        continue;
+                    } else {
+                        stack[top++] = node.offset;
+                        current = current + 1;
+                        continue;
+                    }
+                }
+
+                if(top == 0) break;
+                current = stack[--top];
+            }
+
+            return hit_anything;
+        }
+
+        /// @brief Get the box of the whole hierarchy.
+        /// @return Box of the root node.
+        aabb bounds() const {
+            if(nodes.empty()) return aabb();
+            return node_box(nodes[0]);
+        }
+
+        /// @brief Estimate the cost of tracing a ray through the tree with the surface area heuristic.
+        /// @return Expected node visits (times their relative cost) plus primitive tests of a random ray that hits the root.
+        double sah_cost() const {
+            if(nodes.empty()) return 0;
+            double root_area = node_box(nodes[0]).surface_area();
+            if(root_area <= 0) return 0;
+
+            double cost = 0;
+            for(const flat_bvh_node& node : nodes)
+                cost += node_box(node).surface_area() * (node.count > 0 ? double(node.count) : traversal_cost);
+            return cost / root_area;
+        }
+
+        /// @brief Get the memory used by the nodes and the primitive indices.
+        /// @return Size in bytes.
+        size_t memory_bytes() const {
+            return nodes.size() * sizeof(flat_bvh_node) + prim_indices.size() * sizeof(uint32_t);
+        }
+
+    private:
+        static const int stack_size = 64;
+        // Past this depth nodes are split at the median, which bounds the depth of any
+        // tree over less than 2^32 primitives by the traversal stack size.
+        static const int max_sah_depth = 32;
+        // Cost of visiting a node relative to the cost of testing one primitive.
+        static constexpr double traversal_cost = 1.0;
+        // Number of candidate split planes per axis is bin_count - 1.
+        static const int bin_count = 32;
+        // Inputs smaller than this are built on the calling thread alone.
+        static const size_t parallel_threshold = size_t(1) << 16;
+
+        // Primitive count and box of the primitives whose centroids fall in a bin.
+        struct bin {
+            aabb box;
+            size_t count = 0;
+        };
+
+        // Boxes of a range of primitives.
+        struct range_bounds {
+            aabb box; // Box of the primitives.
+            aabb centroid_box; // Box of the primitives' centroids.
+        };
+
+        // Bins of a range along the three axes, with the boxes of the whole range.
+        struct bin_set : range_bounds {
+            int used = bin_count; // Bins in use, small ranges need fewer of them.
+            bin bins[3][bin_count];
+
+            // Empty the first n bins of each axis and use only those.
+            void reset(int n) {
+                used = n;
+                for(int a = 0; a < 3; a++)
+                    for(int b = 0; b < n; b++) bins[a][b] = bin();
+            }
+        };
+
+        // Node of the top levels of a parallel build, either split or handed to a subtree job.
+        struct top_node {
+            aabb box;
+            int axis = 0;
+            size_t first = 0, second = 0; // Children in the top node list.
+            int job = -1; // Subtree job that replaces this node, -1 if the node was split.
+        };
+
+        // Subtree built by one task into its own node list.
+        struct subtree_job {
+            size_t start, end;
+            int depth;
+            std::vector<flat_bvh_node> nodes;
+        };
+
+        /// @brief Build a node over a range of positions and its whole subtree.
+        /// Different ranges may be built at the same time into different node lists.
+        /// @param boxes Box of each primitive.
+        /// @param start First position.
+        /// @param end Position after the last one.
+        /// @param depth Depth of the node.
+        /// @param out Node list, second child offsets are relative to its start.
+        /// @param set Bins reused by every node of the subtree, so they are not set up again for each.
+        /// @return Index of the node in the list.
+        uint32_t build_node(const std::vector<aabb>& boxes, size_t start, size_t end, int depth,
+                            std::vector<flat_bvh_node>& out, bin_set& set) {
+            uint32_t index = uint32_t(out.size());
+            out.emplace_back();
+
+            range_bounds bounds;
+            bound_range(boxes, start, end, bounds);
+            set_bounds(out[index], bounds.box);
+
+            size_t span = end - start;
+            bool degenerate = is_degenerate(bounds.centroid_box);
+
+            if(span == 1 || (degenerate && span <= size_t(max_leaf_size))) {
+                make_leaf(out[index], start, span);
+                return index;
+            }
+
+            int axis = widest_axis(bounds.centroid_box);
+            size_t mid = start + span / 2;
+
+            if(depth >= max_sah_depth || degenerate) {
+                median_split(boxes, start, end, axis);
+            } else {
+                static_cast<range_bounds&>(set) = bounds;
+                set.reset(span < size_t(bin_count) ? int(span) : bin_count);
+                bin_range(boxes, start, end, set);
+                int split_bin;
+                double split_cost = find_split(set, span, axis, split_bin);
+                if(span <= size_t(max_leaf_size) && double(span) <= split_cost) {
+                    make_leaf(out[index], start, span);
+                    return index;
+                }
+                mid = partition(boxes, start, end, set, axis, split_bin);
+            }
+
+            build_node(boxes, start, mid, depth + 1, out, set);
+            uint32_t second = build_node(boxes, mid, end, depth + 1, out, set);
+            out[index].offset = second;
+            out[index].count = 0;
+            out[index].axis = uint8_t(axis);
+            return index;
+        }
+
+        /// @brief Split the top levels of a large build, binning each range on the pool's workers.
+        /// Ranges no larger than the grain become subtree jobs.
+        /// @param boxes Box of each primitive.
+        /// @param start First position.
+        /// @param end Position after the last one.
+        /// @param depth Depth of the node.
+        /// @param grain Largest range handed to a job.
+        /// @param pool Pool of workers.
+        /// @param top Top nodes.
+        /// @param jobs Subtree jobs.
+        /// @return Index of the top node.
+        size_t build_top(const std::vector<aabb>& boxes, size_t start, size_t end, int depth, size_t grain,
+                         thread_pool& pool, std::vector<top_node>& top, std::vector<subtree_job>& jobs) {
+            size_t index = top.size();
+            top.emplace_back();
+
+            if(end - start <= grain) {
+                top[index].job = int(jobs.size());
+                jobs.push_back({start, end, depth, {}});
+                return index;
+            }
+
+            // Two passes over chunks of the range: the boxes, then the bins that depend on them.
+            size_t chunks = size_t(4 * pool.size());
+            std::vector<bin_set> partial(chunks);
+            auto run_chunks = [&](bool binning) {
+                for(size_t c = 0; c < chunks; c++) {
+                    size_t s = start + (end - start) * c / chunks, e = start + (end - start) * (c + 1) / chunks;
+                    pool.submit([this, &boxes, &partial, c, s, e, binning] {
+                        if(binning) bin_range(boxes, s, e, partial[c]);
+                        else bound_range(boxes, s, e, partial[c]);
+                    });
+                }
+                pool.wait();
+            };
+
+            run_chunks(false);
+            bin_set set;
+            for(const bin_set& p : partial) {
+                set.box = aabb(set.box, p.box);
+                set.centroid_box = aabb(set.centroid_box, p.centroid_box);
+            }
+            for(bin_set& p : partial) p.centroid_box = set.centroid_box;
+
+            int axis = widest_axis(set.centroid_box);
+            size_t mid = start + (end - start) / 2;
+
+            // Same depth cap as build_node, so the subtrees below keep the bound on the tree's depth.
+            if(depth >= max_sah_depth || is_degenerate(set.centroid_box)) {
+                median_split(boxes, start, end, axis);
+            } else {
+                run_chunks(true);
+                for(const bin_set& p : partial)
+                    for(int a = 0; a < 3; a++)
+                        for(int b = 0; b < bin_count; b++) {
+                            set.bins[a][b].box = aabb(set.bins[a][b].box, p.bins[a][b].box);
+                            set.bins[a][b].count += p.bins[a][b].count;
+                        }
+                int split_bin;
+                find_split(set, end - start, axis, split_bin);
+                mid = partition(boxes, start, end, set, axis, split_bin);
+            }
+
+            top[index].box = set.box;
+            top[index].axis = axis;
+            size_t first = build_top(boxes, start, mid, depth + 1, grain, pool, top, jobs);
+            size_t second = build_top(boxes, mid, end, depth + 1, grain, pool, top, jobs);
+            top[index].first = first;
+            top[index].second = second;
+            return index;
+        }
+
+        /// @brief Append a top node and everything under it to the nodes, in depth-first order.
+        /// @param top Top nodes.
+        /// @param jobs Finished subtree jobs.
+        /// @param t Top node.
+        void splice(const std::vector<top_node>& top, const std::vector<subtree_job>& jobs, size_t t) {
+            if(top[t].job >= 0) {
+                uint32_t base = uint32_t(nodes.size());
+                for(flat_bvh_node node : jobs[top[t].job].nodes) {
+                    if(node.count == 0) node.offset += base;
+                    nodes.push_back(node);
+                }
+                return;
+            }
+
+            size_t index = nodes.size();
+            nodes.emplace_back();
+            set_bounds(nodes[index], top[t].box);
+            splice(top, jobs, top[t].first);
+            nodes[index].offset = uint32_t(nodes.size());
+            nodes[index].axis = uint8_t(top[t].axis);
+            splice(top, jobs, top[t].second);
+        }
+
+        /// @brief Compute the box of a range and the box of its centroids.
+        /// @param boxes Box of each primitive.
+        /// @param start First position.
+        /// @param end Position after the last one.
+        /// @param bounds Boxes, grown to enclose the range.
+        void bound_range(const std::vector<aabb>& boxes, size_t start, size_t end, range_bounds& bounds) const {
+            for(size_t i = start; i < end; i++) {
+                const aabb& box = boxes[prim_indices[i]];
+                point3 c = box.center();
+                bounds.box = aabb(bounds.box, box);
+                bounds.centroid_box = aabb(bounds.centroid_box, aabb(c, c));
+            }
+        }
+
+        /// @brief Drop the primitives of a range into bins by their centroids.
+        /// @param boxes Box of each primitive.
+        /// @param start First position.
+        /// @param end Position after the last one.
+        /// @param set Bins, with the centroid box already set.
+        void bin_range(const std::vector<aabb>& boxes, size_t start, size_t end, bin_set& set) const {
+            double scale[3];
+            for(int a = 0; a < 3; a++) {
+                double size = set.centroid_box.axis(a).size();
+                scale[a] = size > 0 ? set.used / size : 0;
+            }
+
+            for(size_t i = start; i < end; i++) {
+                const aabb& box = boxes[prim_indices[i]];
+                point3 c = box.center();
+                for(int a = 0; a < 3; a++) {
+                    bin& b = set.bins[a][bin_of(c[a], set.centroid_box.axis(a).min, scale[a], set.used)];
+                    b.box = aabb(b.box, box);
+                    b.count++;
+                }
+            }
+        }
+
+        /// @brief Find the cheapest split between bins.
+        /// @param set Bins of the range.
+        /// @param span Number of primitives in the range.
+        /// @param best_axis Axis of the best split.
+        /// @param best_bin Last bin to the left of the best split.
+        /// @return Estimated cost of the split, in primitive tests.
+        static double find_split(const bin_set& set, size_t span, int& best_axis, int& best_bin) {
+            double best_cost = infinity;
+            int n = set.used;
+            best_bin = n / 2 - 1;
+
+            for(int axis = 0; axis < 3; axis++) {
+                if(set.centroid_box.axis(axis).size() <= 0) continue;
+                const bin* bins = set.bins[axis];
+
+                double right_cost[bin_count];
+                aabb right_box;
+                size_t right_count = 0;
+                for(int b = n - 1; b > 0; b--) {
+                    right_box = aabb(right_box, bins[b].box);
+                    right_count += bins[b].count;
+                    right_cost[b] = right_box.surface_area() * right_count;
+                }
+
+                aabb left_box;
+                size_t left_count = 0;
+                for(int b = 0; b < n - 1; b++) {
+                    left_box = aabb(left_box, bins[b].box);
+                    left_count += bins[b].count;
+                    if(left_count == 0 || left_count == span) continue;
+                    double cost = left_box.surface_area() * left_count + right_cost[b + 1];
+                    if(cost < best_cost) {
+                        best_cost = cost;
+                        best_axis = axis;
+                        best_bin = b;
+                    }
+                }
+            }
+
+            double area = set.box.surface_area();
+            return traversal_cost + (area > 0 ? best_cost / area : double(span));
+        }
+
+        /// @brief Move the primitives of the bins up to a split bin to the front of a range.
+        /// Falls back to a median split if either side ends up empty.
+        /// @param boxes Box of each primitive.
+        /// @param start First position.
+        /// @param end Position after the last one.
+        /// @param set Bins of the range.
+        /// @param axis Split axis.
+        /// @param split_bin Last bin of the left side.
+        /// @return First position of the right side.
+        size_t partition(const std::vector<aabb>& boxes, size_t start, size_t end, const bin_set& set,
+                         int axis, int split_bin) {
+            double min = set.centroid_box.axis(axis).min;
+            double scale = set.used / set.centroid_box.axis(axis).size();
+            int n = set.used;
+            auto middle = std::partition(prim_indices.begin() + start, prim_indices.begin() + end,
+                                         [&](uint32_t p) {
+                                             return bin_of(boxes[p].center()[axis], min, scale, n) <= split_bin;
+                                         });
+            size_t mid = size_t(middle - prim_indices.begin());
+            if(mid == start || mid == end) {
+                median_split(boxes, start, end, axis);
+                mid = start + (end - start) / 2;
+            }
+            return mid;
+        }
+
+        /// @brief Split a range in two halves by the centroids along an axis.
+        /// @param boxes Box of each primitive.
+        /// @param start First position.
+        /// @param end Position after the last one.
+        /// @param axis Axis.
+        void median_split(const std::vector<aabb>& boxes, size_t start, size_t end, int axis) {
+            std::nth_element(prim_indices.begin() + start, prim_indices.begin() + start + (end - start) / 2,
+                             prim_indices.begin() + end, [&](uint32_t a, uint32_t b) {
+                                 return boxes[a].center()[axis] < boxes[b].center()[axis];
+                             });
+        }
+
+        /// @brief Get the bin of a centroid coordinate.
+        /// @param c Coordinate.
+        /// @param min Smallest centroid coordinate along the axis.
+        /// @param scale Number of bins over the centroids' extent along the axis.
+        /// @param n Number of bins.
+        /// @return Bin index.
+        static int bin_of(double c, double min, double scale, int n) {
+            int b = int((c - min) * scale);
+            return b < 0 ? 0 : (b >= n ? n - 1 : b);
+        }
+
+        static bool is_degenerate(const aabb& centroid_box) {
+            return centroid_box.x.size() <= 0 && centroid_box.y.size() <= 0 && centroid_box.z.size() <= 0;
+        }
+
+        static int widest_axis(const aabb& box) {
+            int axis = 0;
+            for(int a = 1; a < 3; a++)
+                if(box.axis(a).size() > box.axis(axis).size()) axis = a;
+            return axis;
+        }
+
+        /// @brief Turn a node into a leaf over a range of positions.
+        /// Ranges too large for the count field are never made leaves, see build_node.
+        /// @param node Node.
+        /// @param start First position.
+        /// @param span Number of primitives.
+        static void make_leaf(flat_bvh_node& node, size_t start, size_t span) {
+            node.offset = uint32_t(start);
+            node.count = uint16_t(span);
+            node.axis = 0;
+        }
+
+        /// @brief Refit a contiguous run of nodes whose children are either inside it or already refit.
+        /// @param boxes Box of each primitive.
+        /// @param begin First node.
+        /// @param end Node after the last one.
+        void refit_range(const std::vector<aabb>& boxes, size_t begin, size_t end) {
+            for(size_t i = end; i > begin; i--)
+                refit_node(boxes, i - 1);
+        }
+
+        /// @brief Recompute a node's box from its primitives or from its children's boxes.
+        /// @param boxes Box of each primitive.
+        /// @param i Node.
+        void refit_node(const std::vector<aabb>& boxes, size_t i) {
+            flat_bvh_node& node = nodes[i];
+            if(node.count > 0) {
+                aabb box;
+                for(uint32_t p = node.offset; p < node.offset + node.count; p++)
+                    box = aabb(box, boxes[prim_indices[p]]);
+                set_bounds(node, box);
+                return;
+            }
+
+            const flat_bvh_node& first = nodes[i + 1];
+            const flat_bvh_node& second = nodes[node.offset];
+            for(int a = 0; a < 3; a++) {
+                node.lo[a] = min_of(first.lo[a], second.lo[a]);
+                node.hi[a] = max_of(first.hi[a], second.hi[a]);
+            }
+        }
+
+        /// @brief Get the end of a node's subtree in the depth-first node list.
+        /// @param i Node.
+        /// @return Index after the subtree's last node.
+        size_t subtree_end(size_t i) const {
+            while(nodes[i].count == 0)
+                i = nodes[i].offset;
+            return i + 1;
+        }
+
+        /// @brief Get the box of a node in double precision.
+        /// @param node Node.
+        /// @return Box.
+        static aabb node_box(const flat_bvh_node& node) {
+            return aabb(interval(node.lo[0], node.hi[0]), interval(node.lo[1], node.hi[1]),
+                        interval(node.lo[2], node.hi[2]));
+        }
+
+        /// @brief Store a box in a node, rounded outwards to single precision.
+        /// @param node Node.
+        /// @param box Box.
+        static void set_bounds(flat_bvh_node& node, const aabb& box) {
+            for(int a = 0; a < 3; a++) {
+                node.lo[a] = round_down(box.axis(a).min);
+                node.hi[a] = round_up(box.axis(a).max);
+            }
+        }
+
+        /// @brief Decide if a ray hits a node's box, in single precision.
+        /// Box minimums are measured from the origin rounded up and maximums from the origin
+        /// rounded down, which can only widen the slabs, however far the origin is from the box.
+        /// The exit distance is scaled up by a few rounding errors of the remaining operations,
+        /// so that the lower precision never misses a box the double precision test would hit.
+        /// @param node Node.
+        /// @param o_lo Ray origin, rounded down.
+        /// @param o_hi Ray origin, rounded up.
+        /// @param inv Inverse of the ray direction.
+        /// @param t_min Start of the ray interval.
+        /// @param t_max End of the ray interval.
+        /// @return True if the ray hits the box inside the interval.
+        static bool hit_node(const flat_bvh_node& node, const float o_lo[3], const float o_hi[3], const float inv[3],
+                             float t_min, float t_max) {
+            float tx0 = (node.lo[0] - o_hi[0]) * inv[0], tx1 = (node.hi[0] - o_lo[0]) * inv[0];
+            float ty0 = (node.lo[1] - o_hi[1]) * inv[1], ty1 = (node.hi[1] - o_lo[1]) * inv[1];
+            float tz0 = (node.lo[2] - o_hi[2]) * inv[2], tz1 = (node.hi[2] - o_lo[2]) * inv[2];
+
+            float t_enter = max_of(max_of(min_of(tx0, tx1), min_of(ty0, ty1)), max_of(min_of(tz0, tz1), t_min));
+            float t_exit = min_of(min_of(max_of(tx0, tx1), max_of(ty0, ty1)), max_of(tz0, tz1));
+            t_exit = min_of(t_exit * 1.0000004f, t_max);
+
+            return t_enter <= t_exit;
+        }
+
+        static float min_of(float a, float b) { return a < b ? a : b; }
+        static float max_of(float a, float b) { return a > b ? a : b; }
+};
+
+/// @brief Hittable over a flattened bounding volume hierarchy.
+/// The objects are stored in the order of the tree's leaves, so a leaf's objects
+/// are next to each other in memory.
+class flat_bvh : public hittable {
+    public:
+        /// @brief Function that builds a tree over a set of objects, indexed like them.
+        using tree_builder = std::function<void(const std::vector<shared_ptr<hittable>>&, bvh_tree&)>;
+
+        double rebuild_threshold = 1.5; //!< SAH cost growth, relative to the last build, that makes update rebuild.
+
+        /// @brief Constructor for a hierarchy over all objects of a list.
+        /// @param list List of objects.
+        flat_bvh(const hittable_list& list) : flat_bvh(list.get_objects()) {}
+
+        /// @brief Constructor for a hierarchy over a set of objects.
+        /// @param objects Objects.
+        flat_bvh(const std::vector<shared_ptr<hittable>>& objects) {
+            build(objects);
+        }
+
+        /// @brief Constructor for a hierarchy whose tree is built by another builder, like a
+        /// spatial-split one, whose leaves may reference an object more than once.
+        /// Rebuilds go through the same builder.
+        /// @param objects Objects.
+        /// @param _builder Builder of the tree.
+        flat_bvh(const std::vector<shared_ptr<hittable>>& objects, tree_builder _builder) : builder(std::move(_builder)) {
+            build(objects);
+        }
+
+        /// @brief Build the hierarchy again over the same objects, after some of them moved.
+        /// Over instances this only rebuilds the top level, the instanced objects keep theirs.
+        /// Uses the builder the hierarchy was made with.
+        void rebuild() {
+            std::vector<shared_ptr<hittable>> objects;
+            std::unordered_set<const hittable*> seen;
+            for(const auto& object : prims)
+                if(seen.insert(object.get()).second) objects.push_back(object);
+            build(objects);
+        }
+
+        /// @brief Prepare the hierarchy for a new frame after objects moved.
+        /// Refits the boxes in one linear pass, and only rebuilds when the refit tree's
+        /// SAH cost has grown past rebuild_threshold times the cost right after the last build.
+        /// Refitting a spatial-split tree grows the clipped parts of objects back to their
+        /// whole boxes, which costs quality but stays correct; the rebuild splits them again.
+        /// @return True if the hierarchy was rebuilt.
+        bool update() {
+            std::vector<aabb> boxes(prims.size());
+            bbox = aabb();
+            for(size_t p = 0; p < prims.size(); p++) {
+                boxes[tree.prim_indices[p]] = prims[p]->bounding_box();
+                bbox = aabb(bbox, boxes[tree.prim_indices[p]]);
+            }
+
+            tree.refit(boxes);
+            if(tree.sah_cost() <= rebuild_threshold * built_cost)
+                return false;
+
+            rebuild();
+            return true;
+        }
+
+        /// @brief Finds the closest object of the hierarchy hit by a ray.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @param rec Hit record.
+        /// @return True if the ray hits some object.
+        bool intersect(const ray& r, interval ray_t, hit_record& rec) const override {
+            return tree.traverse(r, ray_t, [&](uint32_t p, interval& t) {
+                if(!intersect_child(*prims[p], r, t, rec)) return false;
+                t.max = rec.t;
+                return true;
+            });
+        }
+
+        /// @brief Decides if any object of the hierarchy blocks a ray, stopping at the first one found.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @return True if the ray hits some object.
+        bool occluded(const ray& r, interval ray_t) const override {
+            return tree.traverse<true>(r, ray_t, [&](uint32_t p, interval& t) {
+                return prims[p]->occluded(r, t);
+            });
+        }
+
+        /// @brief Get the hierarchy's bounding box.
+        /// @return Box that encloses all objects.
+        aabb bounding_box() const override { return bbox; }
+
+        /// @brief Get the hierarchy's tree.
+        /// @return Tree.
+        const bvh_tree& get_tree() const { return tree; }
+
+    private:
+        bvh_tree tree;
+        std::vector<shared_ptr<hittable>> prims; // Objects in leaf order.
+        aabb bbox;
+        double built_cost = 0; // SAH cost right after the last build.
+        tree_builder builder; // Builder of the tree, empty for the binned SAH one.
+
+        /// @brief Build the hierarchy over a set of objects and store them in leaf order.
+        /// @param objects Objects.
+        void build(const std::vector<shared_ptr<hittable>>& objects) {
+            std::vector<aabb> boxes;
+            boxes.reserve(objects.size());
+            bbox = aabb();
+            for(const auto& object : objects) {
+                boxes.push_back(object->bounding_box());
+                bbox = aabb(bbox, boxes.back());
+            }
+
+            if(builder)
+                builder(objects, tree);
+            else
+                tree.build(boxes);
+            store(objects);
+        }
+
+        /// @brief Store the objects in the order of the tree's leaves.
+        /// @param objects Objects, indexed like the boxes the tree was built over.
+        void store(const std::vector<shared_ptr<hittable>>& objects) {
+            prims.clear();
+            prims.reserve(tree.prim_indices.size());
+            for(uint32_t index : tree.prim_indices)
+                prims.push_back(objects[index]);
+
+            built_cost = tree.sah_cost();
+        }
+};
+
+#endif
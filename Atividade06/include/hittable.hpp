@@ -1,18 +1,27 @@
 #ifndef HITTABLE_H
 #define HITTABLE_H
 
-#include "ray.hpp"
+#include "aabb.hpp"
+
+#include <cstdint>
 
 class material;
+class hittable;
 
 /// @brief Class for recording hits and deciding the surface side.
+/// Intersection tests only fill t, object, prim, u and v. The rest is filled once,
+/// for the closest hit, by the object's finalize.
 class hit_record {
   public:
     point3 p;
     vec3 normal;
     double t;
     bool front_face;
-    shared_ptr<material> mat;
+    const material* mat = nullptr; //!< Handle into the scene's material_table, not owned.
+    const hittable* object = nullptr; //!< Object that computes the surface attributes of the hit.
+    uint32_t prim = 0; //!< Primitive inside the object, like a mesh face.
+    double u = 0; //!< First surface coordinate, like a barycentric coordinate.
+    double v = 0; //!< Second surface coordinate.
 
     /// @brief Method for deciding which side is the front face.
     /// @param r Ray.
@@ -38,12 +47,74 @@ class hittable {
     public:
         virtual ~hittable() = default;
 
-        /// @brief Abstract method for deciding a hit.
+        /// @brief Method for deciding a hit, with all surface attributes of the closest one.
+        /// Extensions may override it to fill the whole record at once, and then get
+        /// intersect for free; the other objects override intersect and finalize instead.
         /// @param r Ray.
         /// @param ray_t Valid ray interval.
         /// @param rec Hit record. 
         /// @return True if the ray hits the object or false if it doesn't.
-        virtual bool hit(const ray& r, interval ray_t, hit_record& rec) const = 0;
+        virtual bool hit(const ray& r, interval ray_t, hit_record& rec) const {
+            if(!intersect_child(*this, r, ray_t, rec)) return false;
+            rec.object->finalize(r, rec);
+            return true;
+        }
+
+        /// @brief Method for finding the closest hit, without its surface attributes.
+        /// Only records t, object, prim, u and v, and leaves the record untouched on a miss,
+        /// so containers can pass the same record to all their children.
+        /// By default calls hit, for objects that only override it, and records the hit
+        /// as the object's own, already final. Every object must override one of the two.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @param rec Hit record.
+        /// @return True if the ray hits the object or false if it doesn't.
+        virtual bool intersect(const ray& r, interval ray_t, hit_record& rec) const {
+            if(!hit(r, ray_t, rec)) return false;
+            rec.object = this;
+            return true;
+        }
+
+        /// @brief Method for filling the surface attributes (p, normal, front_face, mat) of a hit
+        /// recorded by intersect. Containers never record hits as their own, so by default it does nothing.
+        /// @param r Ray, the same given to intersect.
+        /// @param rec Hit record.
+        virtual void finalize(const ray& /*r*/, hit_record& /*rec*/) const {}
+
+        /// @brief Method for deciding if anything blocks a ray, for shadow and visibility rays.
+        /// Stops at the first hit and computes no surface attributes. This default
+        /// falls back to the closest hit, objects override it with a cheaper test.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @return True if the ray hits the object inside the interval.
+        virtual bool occluded(const ray& r, interval ray_t) const {
+            hit_record rec;
+            return intersect(r, ray_t, rec);
+        }
+
+        /// @brief Abstract method for getting the object's bounding box.
+        /// @return Box that encloses the whole object.
+        virtual aabb bounding_box() const = 0;
+
+    protected:
+        /// @brief Find the closest hit of a child object, for containers.
+        /// The record points at the object that recorded the hit even when the child
+        /// leaves object unset, and keeps the previous hit's object on a miss.
+        /// @param child Child object.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @param rec Hit record.
+        /// @return True if the ray hits the child.
+        static bool intersect_child(const hittable& child, const ray& r, interval ray_t, hit_record& rec) {
+            const hittable* previous = rec.object;
+            rec.object = nullptr;
+            if(!child.intersect(r, ray_t, rec)) {
+                rec.object = previous;
+                return false;
+            }
+            if(!rec.object) rec.object = &child;
+            return true;
+        }
 };
 
 #endif
\ No newline at end of file
@@ -12,8 +12,6 @@ using std::make_shared;
 /// @brief Class for a list of hittable objects, can represent a world.
 class hittable_list : public hittable {
     public:
-        std::vector<shared_ptr<hittable>> objects;
-
         /// @brief Empty constructor.
         hittable_list() {}
 
@@ -22,33 +20,69 @@ class hittable_list : public hittable {
         hittable_list(shared_ptr<hittable> object) { add(object); }
 
         /// @brief Remove all objects from world.
-        void clear() { objects.clear(); }
+        void clear() {
+            objects.clear();
+            bbox = aabb();
+        }
 
         /// @brief Add an object to the world.
         /// @param object Object to be added.
         void add(shared_ptr<hittable> object) {
             objects.push_back(object);
+            bbox = aabb(bbox, object->bounding_box());
         }
 
-        /// @brief Decides if a ray hits any object from the world.
+        /// @brief Finds the closest object from the world hit by a ray.
+        /// Objects only write the record when they hit closer than the current hit,
+        /// so they all share it.
         /// @param r Ray.
         /// @param ray_t Valid ray interval.
         /// @param rec Hit record.
-        bool hit(const ray& r, interval ray_t, hit_record& rec) const override {
-            hit_record temp_rec;
+        bool intersect(const ray& r, interval ray_t, hit_record& rec) const override {
+            // Reject the whole list at once if the ray misses its cached bounds.
+            if(!bbox.hit(r, ray_t))
+                return false;
+
             bool hit_anything = false;
             auto closest_so_far = ray_t.max;
 
             for (const auto& object : objects) {
-                if (object->hit(r, interval(ray_t.min, closest_so_far), temp_rec)) {
+                if (intersect_child(*object, r, interval(ray_t.min, closest_so_far), rec)) {
                     hit_anything = true;
-                    closest_so_far = temp_rec.t;
-                    rec = temp_rec;
+                    closest_so_far = rec.t;
                 }
             }
 
             return hit_anything;
         }
+
+        /// @brief Decides if any object from the world blocks a ray.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @return True at the first object hit.
+        bool occluded(const ray& r, interval ray_t) const override {
+            if(!bbox.hit(r, ray_t))
+                return false;
+
+            for (const auto& object : objects) {
+                if (object->occluded(r, ray_t))
+                    return true;
+            }
+            return false;
+        }
+
+        /// @brief Get the bounding box of all objects.
+        /// @return Box that encloses every object.
+        aabb bounding_box() const override { return bbox; }
+
+        /// @brief Get the objects of the world, which only change through add and clear
+        /// so that the cached bounds stay valid.
+        /// @return Objects.
+        const std::vector<shared_ptr<hittable>>& get_objects() const { return objects; }
+
+    private:
+        std::vector<shared_ptr<hittable>> objects;
+        aabb bbox;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,139 @@
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include "hittable.hpp"
+#include "mat4.hpp"
+
+/// @brief Hittable that places a shared object in the world with a 4x4 affine transform.
+/// Rays are moved into the object's space with the cached inverse, so any number of
+/// instances can share one object (and its acceleration structure) without copying it.
+class instance : public hittable {
+    public:
+        /// @brief Constructor.
+        /// @param _object Object in its own space, usually a hierarchy over a mesh.
+        /// @param _transform Transform from the object's space to the world.
+        instance(shared_ptr<hittable> _object, const mat4& _transform) : object(_object) {
+            set_transform(_transform);
+        }
+
+        /// @brief Move the instance, the object itself is left untouched.
+        /// Hierarchies over instances need to be rebuilt or refit afterwards.
+        /// @param _transform Transform from the object's space to the world.
+        void set_transform(const mat4& _transform) {
+            if(fabs(_transform.det()) < 1e-12) {
+                clog << "> Error: instance transform is not invertible!\n";
+                exit(1);
+            }
+            transform = _transform;
+            inverse = transform.inverse();
+
+            // Box of the transformed corners of the object's box.
+            aabb box = object->bounding_box();
+            bbox = aabb();
+            for(int i = 0; i < 8; i++) {
+                point3 corner((i & 1) ? box.x.max : box.x.min,
+                              (i & 2) ? box.y.max : box.y.min,
+                              (i & 4) ? box.z.max : box.z.min);
+                point3 p = transform_point(transform, corner);
+                bbox = aabb(bbox, aabb(p, p));
+            }
+        }
+
+        /// @brief Get the transform from the object's space to the world.
+        /// @return Transform.
+        const mat4& get_transform() const { return transform; }
+
+        /// @brief Method for finding a hit.
+        /// The ray direction is transformed without normalizing it, so distances
+        /// along the ray are the same in both spaces. The object's surface attributes
+        /// are only known in its own space, so the instance fills them right away and
+        /// records the hit as its own, already final.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @param rec Hit record.
+        /// @return True if the ray hits the object.
+        bool intersect(const ray& r, interval ray_t, hit_record& rec) const override {
+            ray local(transform_point(inverse, r.origin()), transform_vector(inverse, r.direction()));
+            if(!intersect_child(*object, local, ray_t, rec)) return false;
+            rec.object->finalize(local, rec);
+
+            rec.p = transform_point(transform, rec.p);
+            // Normals go through the inverse transpose, which keeps the side they face.
+            const double (*m)[4] = inverse.e;
+            const vec3& n = rec.normal;
+            rec.normal = unit_vector(vec3(m[0][0] * n[0] + m[1][0] * n[1] + m[2][0] * n[2],
+                                          m[0][1] * n[0] + m[1][1] * n[1] + m[2][1] * n[2],
+                                          m[0][2] * n[0] + m[1][2] * n[1] + m[2][2] * n[2]));
+            rec.object = this;
+            return true;
+        }
+
+        /// @brief Nothing to do, hits are filled in world space by intersect.
+        /// @param r Ray.
+        /// @param rec Hit record.
+        void finalize(const ray& /*r*/, hit_record& /*rec*/) const override {}
+
+        /// @brief Decides if the instanced object blocks a ray.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @return True if the ray hits the object.
+        bool occluded(const ray& r, interval ray_t) const override {
+            ray local(transform_point(inverse, r.origin()), transform_vector(inverse, r.direction()));
+            return object->occluded(local, ray_t);
+        }
+
+        /// @brief Get the instance's bounding box.
+        /// @return Box that encloses the transformed object.
+        aabb bounding_box() const override { return bbox; }
+
+    private:
+        shared_ptr<hittable> object;
+        mat4 transform;
+        mat4 inverse;
+        aabb bbox;
+
+        static point3 transform_point(const mat4& m, const point3& p) {
+            return point3(m.e[0][0] * p[0] + m.e[0][1] * p[1] + m.e[0][2] * p[2] + m.e[0][3],
+                          m.e[1][0] * p[0] + m.e[1][1] * p[1] + m.e[1][2] * p[2] + m.e[1][3],
+                          m.e[2][0] * p[0] + m.e[2][1] * p[1] + m.e[2][2] * p[2] + m.e[2][3]);
+        }
+
+        static vec3 transform_vector(const mat4& m, const vec3& v) {
+            return vec3(m.e[0][0] * v[0] + m.e[0][1] * v[1] + m.e[0][2] * v[2],
+                        m.e[1][0] * v[0] + m.e[1][1] * v[1] + m.e[1][2] * v[2],
+                        m.e[2][0] * v[0] + m.e[2][1] * v[1] + m.e[2][2] * v[2]);
+        }
+};
+
+/// @brief Get the transform that translates points.
+/// @param offset Translation.
+/// @return Transform.
+inline mat4 translate(const vec3& offset) {
+    return mat4(1, 0, 0, offset[0],
+                0, 1, 0, offset[1],
+                0, 0, 1, offset[2],
+                0, 0, 0, 1);
+}
+
+/// @brief Get the transform that scales points about the origin.
+/// @param factors Scale along each axis.
+/// @return Transform.
+inline mat4 scale(const vec3& factors) {
+    return mat4(factors[0], 0, 0, 0,
+                0, factors[1], 0, 0,
+                0, 0, factors[2], 0,
+                0, 0, 0, 1);
+}
+
+/// @brief Get the transform that rotates points about the y axis.
+/// @param degrees Angle.
+/// @return Transform.
+inline mat4 rotate_y(double degrees) {
+    double c = cos(degrees_to_radians(degrees)), s = sin(degrees_to_radians(degrees));
+    return mat4(c, 0, s, 0,
+                0, 1, 0, 0,
+                -s, 0, c, 0,
+                0, 0, 0, 1);
+}
+
+#endif
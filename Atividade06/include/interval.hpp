@@ -14,6 +14,27 @@ class interval {
     /// @param _max Maximum value.
     interval(double _min, double _max) : min(_min), max(_max) {}
 
+    /// @brief Constructor for the smallest interval that encloses two intervals.
+    /// Plain comparisons instead of fmin/fmax, since BVH builds do this in their inner loops.
+    /// @param a Interval A.
+    /// @param b Interval B.
+    interval(const interval& a, const interval& b) :
+        min(a.min < b.min ? a.min : b.min), max(a.max > b.max ? a.max : b.max) {}
+
+    /// @brief Get size of interval.
+    /// @return Maximum minus minimum.
+    double size() const {
+        return max - min;
+    }
+
+    /// @brief Get an interval padded on both sides.
+    /// @param delta Total amount to pad.
+    /// @return Padded interval.
+    interval expand(double delta) const {
+        auto padding = delta / 2;
+        return interval(min - padding, max + padding);
+    }
+
     /// @brief Check if value is inside interval, including bounds (like [min, max]).
     /// @param x Value to check.
     bool contains(double x) const {
@@ -3,6 +3,10 @@
 
 #include "hittable.hpp"
 
+#include <memory>
+#include <utility>
+#include <vector>
+
 class hit_record;
 
 /// @brief Class for a generic material.
@@ -18,10 +22,61 @@ class material {
     /// @return True if the scattered ray is valid.
     virtual bool scatter(const ray& r_in, const hit_record& rec, 
                         color& attenuation, ray& scattered) const = 0;
+
+    /// @brief Virtual method for scattering a batch of rays that hit this material.
+    /// By default calls scatter once per ray, batched_material replaces it with a loop
+    /// over the derived class' own method. Either way the kernel is scalar over arrays of
+    /// structures, a placeholder for SoA/SIMD kernels: every ray draws its direction by
+    /// rejection sampling from its own stream, so lanes would not run in step.
+    /// @param n Number of rays.
+    /// @param r_in Incoming rays.
+    /// @param rec Hit records.
+    /// @param rng Random generator of each ray's path.
+    /// @param attenuation Color attenuations.
+    /// @param scattered Scattered rays.
+    /// @param valid True for the scattered rays that are valid.
+    virtual void scatter_batch(size_t n, const ray* r_in, const hit_record* rec, pcg32* rng,
+                               color* attenuation, ray* scattered, bool* valid) const {
+        pcg32& generator = thread_rng();
+        pcg32 saved = generator;
+
+        for(size_t i = 0; i < n; ++i) {
+            // Draw from the ray's own stream, like the scalar path would.
+            generator = rng[i];
+            valid[i] = scatter(r_in[i], rec[i], attenuation[i], scattered[i]);
+            rng[i] = generator;
+        }
+
+        generator = saved;
+    }
+};
+
+/// @brief Base class that implements batch scattering for a material with
+/// a tight loop over the material's own (non-virtual) scatter method.
+/// It only saves the virtual call per ray, the loop body is the scalar scatter.
+/// @tparam derived Material class.
+template <class derived>
+class batched_material : public material {
+  public:
+    void scatter_batch(size_t n, const ray* r_in, const hit_record* rec, pcg32* rng,
+                       color* attenuation, ray* scattered, bool* valid) const override {
+        const derived& self = static_cast<const derived&>(*this);
+        pcg32& generator = thread_rng();
+        pcg32 saved = generator;
+
+        for(size_t i = 0; i < n; ++i) {
+            // Draw from the ray's own stream, like the scalar path would.
+            generator = rng[i];
+            valid[i] = self.derived::scatter(r_in[i], rec[i], attenuation[i], scattered[i]);
+            rng[i] = generator;
+        }
+
+        generator = saved;
+    }
 };
 
 /// @brief Class for a Lambertian (diffuse) material.
-class lambertian : public material {
+class lambertian : public batched_material<lambertian> {
     public:
         /// @brief Constructor.
         /// @param a Levels of light reflection.
@@ -52,7 +107,7 @@ class lambertian : public material {
 };
 
 /// @brief Class for a metalic material.
-class metal : public material {
+class metal : public batched_material<metal> {
     public:
         /// @brief Constructor.
         /// @param a Levels of light reflection.
@@ -81,7 +136,7 @@ class metal : public material {
 };
 
 /// @brief Class for a dielectric material.
-class dielectric : public material {
+class dielectric : public batched_material<dielectric> {
   public:
     /// @brief Constructor.
     /// @param index_of_refraction Refractive index.
@@ -127,4 +182,27 @@ class dielectric : public material {
     }
 };
 
+/// @brief Table that owns the materials of a scene.
+/// Hittables and hit records only hold plain pointers into it, valid for as long as the
+/// table lives, so recording a hit never touches a reference count shared by all render threads.
+class material_table {
+    public:
+        /// @brief Create a material owned by the table.
+        /// @tparam M Material class.
+        /// @param args Arguments of the material's constructor.
+        /// @return Handle of the material.
+        template <class M, class... Args>
+        const material* add(Args&&... args) {
+            materials.push_back(std::make_unique<M>(std::forward<Args>(args)...));
+            return materials.back().get();
+        }
+
+        /// @brief Get number of materials.
+        /// @return Number of materials.
+        size_t size() const { return materials.size(); }
+
+    private:
+        std::vector<std::unique_ptr<material>> materials;
+};
+
 #endif
\ No newline at end of file
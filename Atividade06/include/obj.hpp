@@ -9,6 +9,8 @@
 #include <iomanip>
 
 #include "triangle.hpp"
+#include "triangle_mesh.hpp"
+#include "hittable_list.hpp"
 #include "vec2.hpp"
 
 using namespace std;
@@ -26,7 +28,7 @@ class obj {
 
         /// @brief Constructor.
         /// @param path Path to obj file.
-        obj(string path, shared_ptr<material> _mat);
+        obj(string path, const material* _mat);
 
         /// @brief Get geometric vertices of this object in string format.
         /// @return String formatted for obj files.
@@ -48,8 +50,27 @@ class obj {
         /// @return List of triangle objects.
         vector<triangle> get_triangle_faces();
 
+        /// @brief Get face elements as one hittable list, whose cached bounding box
+        /// rejects rays that miss the whole model.
+        /// @return List of triangle objects.
+        shared_ptr<hittable_list> get_mesh();
+
+        /// @brief Get face elements as one indexed triangle mesh, which shares the
+        /// vertex buffers instead of copying three vertices into every triangle.
+        /// @return Triangle mesh.
+        shared_ptr<triangle_mesh> get_triangle_mesh();
+
+        /// @brief Load an obj file straight into an indexed triangle mesh, for large meshes.
+        /// The parser fills the mesh's buffers and moves them into it, without keeping the
+        /// faces' index lists or a second copy of the vertices. Only positions and normals are
+        /// read, relative (negative) indices are resolved and polygons are split in triangle fans.
+        /// @param path Path to obj file.
+        /// @param _mat Material of the mesh.
+        /// @return Triangle mesh.
+        static shared_ptr<triangle_mesh> load_triangle_mesh(const string& path, const material* _mat);
+
     private:
-        shared_ptr<material> mat;
+        const material* mat;
 
         /// @brief Parse indices separated by the '/' character and convert to int.
         /// @param ind_list String of indices.
@@ -0,0 +1,322 @@
+#ifndef QUANTIZED_BVH_H
+#define QUANTIZED_BVH_H
+
+#include "flat_bvh.hpp"
+
+#include <array>
+#include <cmath>
+#include <type_traits>
+
+/// @brief Node of a quantized hierarchy, whose box is stored in steps of its parent's box.
+/// The box minimum counts steps up from the parent's minimum and the maximum counts steps
+/// down from the parent's maximum, so zero on both sides is the parent's box itself.
+/// With 8-bit steps a node is 16 bytes, four per cache line; with 16-bit steps it is 20.
+/// @tparam T uint8_t or uint16_t.
+template <class T>
+struct quantized_bvh_node {
+    uint32_t offset; //!< Leaf: first primitive position. Inner node: index of the second child.
+    uint16_t count; //!< Number of primitives of a leaf, zero for inner nodes.
+    T lo[3]; //!< Box minimum, in steps up from the parent's minimum.
+    T hi[3]; //!< Box maximum, in steps down from the parent's maximum.
+    uint8_t axis; //!< Split axis of an inner node.
+    uint8_t pad; //!< Unused.
+};
+
+static_assert(sizeof(quantized_bvh_node<uint8_t>) == 16, "8-bit quantized node should be 16 bytes");
+static_assert(sizeof(quantized_bvh_node<uint16_t>) == 20, "16-bit quantized node should be 20 bytes");
+
+/// @brief Bounding volume hierarchy with quantized node boxes.
+/// It copies the topology of a bvh_tree, so primitives are indexed the same way. Each box
+/// is decoded in single precision from the decoded box of its parent, which the traversal
+/// carries on its stack, and is encoded so that the decoded box always encloses the original.
+/// @tparam T uint8_t or uint16_t.
+template <class T>
+class quantized_bvh_tree {
+    static_assert(std::is_same<T, uint8_t>::value || std::is_same<T, uint16_t>::value,
+                  "quantized_bvh_tree steps must be uint8_t or uint16_t");
+
+    public:
+        std::vector<quantized_bvh_node<T>> nodes; //!< Nodes in depth-first order, the root first.
+        std::vector<uint32_t> prim_indices; //!< Original index of the primitive at each position.
+
+        /// @brief Build the hierarchy over a set of boxes.
+        /// @param boxes Box of each primitive.
+        void build(const std::vector<aabb>& boxes) {
+            bvh_tree tree;
+            tree.build(boxes);
+            build(tree);
+        }
+
+        /// @brief Quantize a full precision tree.
+        /// @param tree Tree.
+        void build(const bvh_tree& tree) {
+            prim_indices = tree.prim_indices;
+            nodes.assign(tree.nodes.size(), quantized_bvh_node<T>());
+            if(nodes.empty()) return;
+
+            for(int a = 0; a < 3; a++) {
+                frame_lo[a] = tree.nodes[0].lo[a];
+                frame_hi[a] = tree.nodes[0].hi[a];
+            }
+
+            // Parents come before their children, so the decoded box of every node is
+            // known by the time its children are encoded.
+            std::vector<std::array<float, 6>> decoded(nodes.size());
+            for(int a = 0; a < 3; a++) {
+                decoded[0][a] = frame_lo[a];
+                decoded[0][3 + a] = frame_hi[a];
+            }
+            for(size_t i = 0; i < nodes.size(); i++) {
+                const flat_bvh_node& source = tree.nodes[i];
+                nodes[i].offset = source.offset;
+                nodes[i].count = source.count;
+                nodes[i].axis = source.axis;
+                if(source.count > 0) continue;
+
+                for(uint32_t child : {uint32_t(i + 1), source.offset}) {
+                    const float* parent = decoded[i].data();
+                    encode(parent, parent + 3, tree.nodes[child], nodes[child]);
+                    decode(parent, parent + 3, nodes[child], decoded[child].data(), decoded[child].data() + 3);
+                }
+            }
+        }
+
+        /// @brief Walk the nodes hit by a ray and hand every primitive of the leaves to a callback.
+        /// The nearer child is visited first, like in bvh_tree::traverse.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @param hit_prim Callback bool(uint32_t position, interval& ray_t) that tests the primitive
+        /// at a position and, when it is hit, lowers ray_t.max to the hit distance.
+        /// @return True if the callback reported some hit.
+        /// @tparam any_hit Return at the first hit reported, for occlusion queries.
+        template <bool any_hit = false, class F>
+        bool traverse(const ray& r, interval ray_t, F&& hit_prim) const {
+            if(nodes.empty()) return false;
+
+            const point3& orig = r.origin();
+            const vec3& inv_d = r.inv_direction();
+            // The origin rounded both ways, like in bvh_tree::traverse.
+            const float o_lo[3] = {round_down(orig[0]), round_down(orig[1]), round_down(orig[2])};
+            const float o_hi[3] = {round_up(orig[0]), round_up(orig[1]), round_up(orig[2])};
+            const float inv[3] = {float(inv_d[0]), float(inv_d[1]), float(inv_d[2])};
+            const bool negative[3] = {inv_d[0] < 0, inv_d[1] < 0, inv_d[2] < 0};
+
+            // Node to visit and the decoded box of its parent.
+            struct entry {
+                uint32_t node;
+                float lo[3], hi[3];
+            };
+            entry stack[stack_size];
+            int top = 0;
+            entry current = {0, {frame_lo[0], frame_lo[1], frame_lo[2]}, {frame_hi[0], frame_hi[1], frame_hi[2]}};
+            bool hit_anything = false;
+
+            while(true) {
+                const quantized_bvh_node<T>& node = nodes[current.node];
+                BVH_COUNT(nodes_visited);
+
+                float lo[3], hi[3];
+                decode(current.lo, current.hi, node, lo, hi);
+                if(hit_box(lo, hi, o_lo, o_hi, inv, round_down(ray_t.min), round_up(ray_t.max))) {
+                    if(node.count > 0) {
+                        for(uint32_t p = node.offset; p < node.offset + node.count; p++) {
+                            BVH_COUNT(primitives_tested);
+                            if(hit_prim(p, ray_t)) {
+                                if(any_hit) return true;
+                                hit_anything = true;
+                            }
+                        }
+                    } else {
+                        uint32_t near_child = current.node + 1, far_child = node.offset;
+                        if(negative[node.axis]) std::swap(near_child, far_child);
+
+                        entry& far_entry = stack[top++];
+                        far_entry.node = far_child;
+                        current.node = near_child;
+                        for(int a = 0; a < 3; a++) {
+                            far_entry.lo[a] = current.lo[a] = lo[a];
+                            far_entry.hi[a] = current.hi[a] = hi[a];
+                        }
+                        continue;
+                    }
+                }
+
+                if(top == 0) break;
+                current = stack[--top];
+            }
+
+            return hit_anything;
+        }
+
+        /// @brief Estimate the cost of tracing a ray through the tree with the surface area heuristic,
+        /// like bvh_tree::sah_cost but over the decoded boxes, so it shows what quantization loosens.
+        /// @return Expected node visits plus primitive tests of a random ray that hits the root.
+        double sah_cost() const {
+            if(nodes.empty()) return 0;
+
+            std::vector<std::array<float, 6>> decoded(nodes.size());
+            for(int a = 0; a < 3; a++) {
+                decoded[0][a] = frame_lo[a];
+                decoded[0][3 + a] = frame_hi[a];
+            }
+            double root_area = area(decoded[0].data());
+            if(root_area <= 0) return 0;
+
+            double cost = 0;
+            for(size_t i = 0; i < nodes.size(); i++) {
+                const quantized_bvh_node<T>& node = nodes[i];
+                cost += area(decoded[i].data()) * (node.count > 0 ? double(node.count) : 1.0);
+                if(node.count > 0) continue;
+                for(uint32_t child : {uint32_t(i + 1), node.offset}) {
+                    const float* parent = decoded[i].data();
+                    decode(parent, parent + 3, nodes[child], decoded[child].data(), decoded[child].data() + 3);
+                }
+            }
+            return cost / root_area;
+        }
+
+        /// @brief Get the memory used by the nodes and the primitive indices.
+        /// @return Size in bytes.
+        size_t memory_bytes() const {
+            return nodes.size() * sizeof(quantized_bvh_node<T>) + prim_indices.size() * sizeof(uint32_t);
+        }
+
+    private:
+        // Entries left on the stack per level are one, and the source tree is at most 64 deep.
+        static const int stack_size = 64;
+        static constexpr float steps = float(std::numeric_limits<T>::max());
+
+        float frame_lo[3] = {0, 0, 0}; // Box of the root.
+        float frame_hi[3] = {0, 0, 0};
+
+        /// @brief Decode a node's box from its parent's decoded box.
+        /// @param parent_lo Parent's box minimum.
+        /// @param parent_hi Parent's box maximum.
+        /// @param node Node.
+        /// @param lo Box minimum.
+        /// @param hi Box maximum.
+        static void decode(const float parent_lo[3], const float parent_hi[3], const quantized_bvh_node<T>& node,
+                           float lo[3], float hi[3]) {
+            for(int a = 0; a < 3; a++) {
+                float step = (parent_hi[a] - parent_lo[a]) * (1.0f / steps);
+                lo[a] = parent_lo[a] + float(node.lo[a]) * step;
+                hi[a] = parent_hi[a] - float(node.hi[a]) * step;
+            }
+        }
+
+        /// @brief Encode a node's box in steps of its parent's decoded box, rounding outwards.
+        /// The steps are checked against decode, so single precision rounding never makes
+        /// the decoded box smaller than the original one.
+        /// @param parent_lo Parent's box minimum.
+        /// @param parent_hi Parent's box maximum.
+        /// @param source Full precision node.
+        /// @param node Quantized node.
+        static void encode(const float parent_lo[3], const float parent_hi[3], const flat_bvh_node& source,
+                           quantized_bvh_node<T>& node) {
+            for(int a = 0; a < 3; a++) {
+                float step = (parent_hi[a] - parent_lo[a]) * (1.0f / steps);
+                if(!(step > 0)) {
+                    node.lo[a] = node.hi[a] = 0;
+                    continue;
+                }
+                node.lo[a] = T(std::clamp(std::floor((source.lo[a] - parent_lo[a]) / step), 0.0f, steps));
+                node.hi[a] = T(std::clamp(std::floor((parent_hi[a] - source.hi[a]) / step), 0.0f, steps));
+                while(node.lo[a] > 0 && parent_lo[a] + float(node.lo[a]) * step > source.lo[a]) node.lo[a]--;
+                while(node.hi[a] > 0 && parent_hi[a] - float(node.hi[a]) * step < source.hi[a]) node.hi[a]--;
+            }
+        }
+
+        static double area(const float box[6]) {
+            double dx = box[3] - box[0], dy = box[4] - box[1], dz = box[5] - box[2];
+            return dx * dy + dy * dz + dz * dx;
+        }
+
+        /// @brief Decide if a ray hits a box, in single precision, like bvh_tree's node test.
+        /// @param lo Box minimum.
+        /// @param hi Box maximum.
+        /// @param o_lo Ray origin, rounded down.
+        /// @param o_hi Ray origin, rounded up.
+        /// @param inv Inverse of the ray direction.
+        /// @param t_min Start of the ray interval.
+        /// @param t_max End of the ray interval.
+        /// @return True if the ray hits the box inside the interval.
+        static bool hit_box(const float lo[3], const float hi[3], const float o_lo[3], const float o_hi[3],
+                            const float inv[3], float t_min, float t_max) {
+            float t_enter = t_min, t_exit = std::numeric_limits<float>::infinity();
+            for(int a = 0; a < 3; a++) {
+                float t0 = (lo[a] - o_hi[a]) * inv[a], t1 = (hi[a] - o_lo[a]) * inv[a];
+                if(t0 > t1) std::swap(t0, t1);
+                t_enter = t0 > t_enter ? t0 : t_enter;
+                t_exit = t1 < t_exit ? t1 : t_exit;
+            }
+            t_exit = t_exit * 1.0000004f;
+            t_exit = t_exit < t_max ? t_exit : t_max;
+            return t_enter <= t_exit;
+        }
+};
+
+/// @brief Hittable over a quantized bounding volume hierarchy, a smaller index for large worlds.
+/// The objects are stored in the order of the tree's leaves, like in flat_bvh.
+/// @tparam T uint8_t or uint16_t, see quantized_bvh_node.
+template <class T = uint8_t>
+class quantized_bvh : public hittable {
+    public:
+        /// @brief Constructor for a hierarchy over all objects of a list.
+        /// @param list List of objects.
+        quantized_bvh(const hittable_list& list) : quantized_bvh(list.get_objects()) {}
+
+        /// @brief Constructor for a hierarchy over a set of objects.
+        /// @param objects Objects.
+        quantized_bvh(const std::vector<shared_ptr<hittable>>& objects) {
+            std::vector<aabb> boxes;
+            boxes.reserve(objects.size());
+            for(const auto& object : objects) {
+                boxes.push_back(object->bounding_box());
+                bbox = aabb(bbox, boxes.back());
+            }
+
+            tree.build(boxes);
+
+            prims.reserve(objects.size());
+            for(uint32_t index : tree.prim_indices)
+                prims.push_back(objects[index]);
+        }
+
+        /// @brief Finds the closest object of the hierarchy hit by a ray.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @param rec Hit record.
+        /// @return True if the ray hits some object.
+        bool intersect(const ray& r, interval ray_t, hit_record& rec) const override {
+            return tree.traverse(r, ray_t, [&](uint32_t p, interval& t) {
+                if(!intersect_child(*prims[p], r, t, rec)) return false;
+                t.max = rec.t;
+                return true;
+            });
+        }
+
+        /// @brief Decides if any object of the hierarchy blocks a ray, stopping at the first one found.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @return True if the ray hits some object.
+        bool occluded(const ray& r, interval ray_t) const override {
+            return tree.template traverse<true>(r, ray_t, [&](uint32_t p, interval& t) {
+                return prims[p]->occluded(r, t);
+            });
+        }
+
+        /// @brief Get the hierarchy's bounding box.
+        /// @return Box that encloses all objects.
+        aabb bounding_box() const override { return bbox; }
+
+        /// @brief Get the hierarchy's tree.
+        /// @return Tree.
+        const quantized_bvh_tree<T>& get_tree() const { return tree; }
+
+    private:
+        quantized_bvh_tree<T> tree;
+        std::vector<shared_ptr<hittable>> prims; // Objects in leaf order.
+        aabb bbox;
+};
+
+#endif
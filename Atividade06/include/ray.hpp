@@ -3,6 +3,8 @@
 
 #include "vec3.hpp"
 
+#include <utility>
+
 // Alias
 using color = vec3;
 
@@ -15,15 +17,37 @@ class ray {
         /// @brief Default constructor.
         /// @param origin Origin of the ray.
         /// @param direction Direction of the ray.
-        ray(const point3& origin, const vec3& direction) : orig(origin), dir(direction) {}
+        ray(const point3& origin, const vec3& direction) :
+            orig(origin), dir(direction), inv_dir(1 / direction[0], 1 / direction[1], 1 / direction[2]) {
+            // The dominant axis becomes z, keeping the winding of the other two.
+            double ax = fabs(dir[0]), ay = fabs(dir[1]), az = fabs(dir[2]);
+            kz = ax > ay ? (ax > az ? 0 : 2) : (ay > az ? 1 : 2);
+            kx = (kz == 2) ? 0 : kz + 1;
+            ky = (kx == 2) ? 0 : kx + 1;
+            if(dir[kz] < 0) std::swap(kx, ky);
+            shear = vec3(dir[kx] * inv_dir[kz], dir[ky] * inv_dir[kz], inv_dir[kz]);
+        }
 
         /// @brief Get ray origin.
         /// @return Ray origin.
-        point3 origin() const { return orig; }
+        const point3& origin() const { return orig; }
 
         /// @brief Get ray direction.
         /// @return Ray direction.
-        vec3 direction() const { return dir; }
+        const vec3& direction() const { return dir; }
+
+        /// @brief Get the inverse of each component of the ray direction, used by box tests.
+        /// @return Inverse ray direction.
+        const vec3& inv_direction() const { return inv_dir; }
+
+        /// @brief Get the axes of the ray's shear frame, in which the direction is the z axis.
+        /// @param n 0, 1 or 2 for the frame's x, y and z axes.
+        /// @return World axis.
+        int shear_axis(int n) const { return n == 0 ? kx : (n == 1 ? ky : kz); }
+
+        /// @brief Get the shear that maps the ray direction to the z axis of its frame, used by triangle tests.
+        /// @return Shear factors of the frame's x and y axes, and the inverse of the direction's z.
+        const vec3& shear_factors() const { return shear; }
 
         /// @brief Get a point in the ray given an offset.
         /// @param t Offset.
@@ -35,6 +59,18 @@ class ray {
     private:
         point3 orig;
         vec3 dir;
+        vec3 inv_dir;
+        int kx = 0, ky = 1, kz = 2;
+        vec3 shear;
 };
 
+/// @brief Get the color of the sky seen by a ray that hits nothing.
+/// @param r Ray.
+/// @return Sky color.
+inline color sky_color(const ray& r) {
+    vec3 unit_direction = unit_vector(r.direction());
+    double a = 0.5 * (unit_direction.y() + 1.0);
+    return (1.0 - a)*color(1.0, 1.0, 1.0) + a*color(0.5, 0.7, 1.0);
+}
+
 #endif
\ No newline at end of file
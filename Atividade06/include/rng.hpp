@@ -0,0 +1,85 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstddef>
+#include <cstdint>
+
+/// @brief Small-state PCG32 random number generator (XSH RR variant).
+/// Holds only 16 bytes of state and supports 2^63 independent streams,
+/// so every pixel can draw from its own stream.
+class pcg32 {
+    public:
+        /// @brief Constructor.
+        /// @param init_state Starting state.
+        /// @param stream Stream selector.
+        pcg32(uint64_t init_state = 0x853c49e6748fea9bULL, uint64_t stream = 0xda3e39cb94b95bdbULL) {
+            seed(init_state, stream);
+        }
+
+        /// @brief Restart the generator.
+        /// @param init_state Starting state.
+        /// @param stream Stream selector.
+        void seed(uint64_t init_state, uint64_t stream) {
+            state = 0;
+            inc = (stream << 1u) | 1u;
+            next_uint();
+            state += init_state;
+            next_uint();
+        }
+
+        /// @brief Get a random 32-bit integer.
+        /// @return Random integer.
+        uint32_t next_uint() {
+            uint64_t old_state = state;
+            state = old_state * 6364136223846793005ULL + inc;
+            uint32_t xorshifted = static_cast<uint32_t>(((old_state >> 18u) ^ old_state) >> 27u);
+            uint32_t rot = static_cast<uint32_t>(old_state >> 59u);
+            return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+        }
+
+        /// @brief Get a random real number in [0, 1).
+        /// @return Random real number.
+        double next_double() {
+            return next_uint() * (1.0 / 4294967296.0);
+        }
+
+        /// @brief Fill a buffer with random real numbers in [0, 1).
+        /// @param out Buffer.
+        /// @param n Number of values.
+        void fill(double* out, size_t n) {
+            for(size_t i = 0; i < n; ++i)
+                out[i] = next_double();
+        }
+
+    private:
+        uint64_t state;
+        uint64_t inc;
+};
+
+/// @brief Scramble a 64-bit value (SplitMix64 finalizer), used to derive seeds.
+/// @param x Value.
+/// @return Scrambled value.
+inline uint64_t mix_bits(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/// @brief Get the generator of the calling thread.
+/// @return Thread's generator.
+inline pcg32& thread_rng() {
+    static thread_local pcg32 generator;
+    return generator;
+}
+
+/// @brief Point the calling thread's generator to the stream of one pixel sample,
+/// so results don't depend on which thread renders the sample.
+/// @param seed Base seed of the render.
+/// @param pixel Pixel index.
+/// @param sample Sample index.
+inline void seed_sample_stream(uint64_t seed, uint64_t pixel, uint64_t sample) {
+    thread_rng().seed(mix_bits(seed ^ mix_bits(sample)), pixel);
+}
+
+#endif
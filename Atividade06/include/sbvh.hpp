@@ -0,0 +1,413 @@
+#ifndef SBVH_H
+#define SBVH_H
+
+#include "flat_bvh.hpp"
+#include "triangle.hpp"
+
+#include <array>
+
+/// @brief Builder of hierarchies over triangles with spatial splits (SBVH).
+/// Besides splitting the set of triangles, a node may split space: triangles that
+/// cross the plane are referenced on both sides, each with only the box of its part
+/// on that side. Long thin triangles then stop inflating every box they touch.
+/// Spatial splits are only tried where the children of the best object split overlap,
+/// and the number of extra references is capped.
+class sbvh_builder {
+    public:
+        double max_growth = 0.5; //!< Extra references allowed, as a fraction of the triangle count.
+        double overlap_threshold = 1e-5; //!< Child overlap, relative to the root's area, from which spatial splits are tried.
+        int max_leaf_size = 4; //!< Maximum number of references in a leaf.
+
+        /// @brief Build a tree over triangles.
+        /// Its prim_indices may hold a triangle more than once.
+        /// @param triangles Vertices of each triangle.
+        /// @param tree Tree to fill.
+        /// @return Number of references in the tree's leaves.
+        size_t build(const std::vector<std::array<point3, 3>>& triangles, bvh_tree& tree) {
+            tree.nodes.clear();
+            tree.prim_indices.clear();
+            tree.max_leaf_size = max_leaf_size;
+            if(triangles.empty()) return 0;
+
+            tris = &triangles;
+            out = &tree;
+            budget = size_t(max_growth * triangles.size());
+
+            std::vector<reference> refs;
+            refs.reserve(triangles.size());
+            aabb root;
+            for(uint32_t i = 0; i < triangles.size(); i++) {
+                const auto& v = triangles[i];
+                aabb box = aabb(aabb(v[0], v[1]), aabb(v[2], v[2])).pad();
+                refs.push_back({i, box});
+                root = aabb(root, box);
+            }
+            root_area = root.surface_area();
+
+            tree.nodes.reserve(2 * triangles.size());
+            build_node(refs, root, 0);
+            return tree.prim_indices.size();
+        }
+
+    private:
+        static const int bin_count = 32;
+        static const int max_sah_depth = 32;
+        static constexpr double traversal_cost = 1.0;
+
+        // Triangle, or the part of it inside a box.
+        struct reference {
+            uint32_t prim;
+            aabb box;
+        };
+
+        // Split candidate.
+        struct split {
+            double cost = infinity;
+            int axis = 0;
+            int bin = 0; // Last bin of the left side.
+            bool spatial = false;
+            double overlap = 0; // Area of the intersection of an object split's children.
+        };
+
+        const std::vector<std::array<point3, 3>>* tris = nullptr;
+        bvh_tree* out = nullptr;
+        size_t budget = 0; // Extra references still allowed.
+        double root_area = 0;
+
+        /// @brief Build a node over a set of references and its whole subtree.
+        /// @param refs References, consumed.
+        /// @param box Box of the references.
+        /// @param depth Depth of the node.
+        void build_node(std::vector<reference>& refs, const aabb& box, int depth) {
+            uint32_t index = uint32_t(out->nodes.size());
+            out->nodes.emplace_back();
+            bvh_tree::set_bounds(out->nodes[index], box);
+
+            size_t n = refs.size();
+            aabb centroid_box;
+            for(const reference& ref : refs) {
+                point3 c = ref.box.center();
+                centroid_box = aabb(centroid_box, aabb(c, c));
+            }
+
+            if(n == 1) {
+                make_leaf(index, refs);
+                return;
+            }
+
+            split best;
+            if(depth < max_sah_depth) {
+                best = object_split(refs, centroid_box);
+                if(best.overlap / root_area > overlap_threshold && budget > 0) {
+                    split candidate = spatial_split(refs, box);
+                    if(candidate.cost < best.cost) best = candidate;
+                }
+            }
+
+            double area = box.surface_area();
+            double split_cost = traversal_cost + (area > 0 ? best.cost / area : double(n));
+            if(n <= size_t(max_leaf_size) && (double(n) <= split_cost || best.cost == infinity)) {
+                make_leaf(index, refs);
+                return;
+            }
+
+            std::vector<reference> left, right;
+            bool done = false;
+            if(best.spatial)
+                done = partition_spatial(refs, box, best, left, right);
+            if(!done && best.cost < infinity && !best.spatial)
+                done = partition_object(refs, centroid_box, best, left, right);
+            if(!done)
+                partition_median(refs, centroid_box, left, right);
+
+            refs.clear();
+            refs.shrink_to_fit();
+
+            aabb left_box, right_box;
+            for(const reference& ref : left) left_box = aabb(left_box, ref.box);
+            for(const reference& ref : right) right_box = aabb(right_box, ref.box);
+
+            build_node(left, left_box, depth + 1);
+            uint32_t second = uint32_t(out->nodes.size());
+            build_node(right, right_box, depth + 1);
+
+            flat_bvh_node& node = out->nodes[index];
+            node.offset = second;
+            node.count = 0;
+            node.axis = uint8_t(best.axis);
+        }
+
+        /// @brief Turn a node into a leaf and append its references to the tree.
+        /// @param index Node.
+        /// @param refs References.
+        void make_leaf(uint32_t index, const std::vector<reference>& refs) {
+            bvh_tree::make_leaf(out->nodes[index], out->prim_indices.size(), refs.size());
+            for(const reference& ref : refs)
+                out->prim_indices.push_back(ref.prim);
+        }
+
+        /// @brief Find the best binned SAH split of the references by their centroids.
+        /// @param refs References.
+        /// @param centroid_box Box of the references' centroids.
+        /// @return Best split, with the overlap of its children.
+        split object_split(const std::vector<reference>& refs, const aabb& centroid_box) const {
+            split best;
+            for(int axis = 0; axis < 3; axis++) {
+                const interval& range = centroid_box.axis(axis);
+                if(range.size() <= 0) continue;
+
+                aabb bins[bin_count];
+                size_t counts[bin_count] = {};
+                for(const reference& ref : refs) {
+                    int b = bin_of(ref.box.center()[axis], range.min, bin_count / range.size());
+                    bins[b] = aabb(bins[b], ref.box);
+                    counts[b]++;
+                }
+
+                aabb right_boxes[bin_count];
+                size_t right_counts[bin_count];
+                aabb right_box;
+                size_t right_count = 0;
+                for(int b = bin_count - 1; b > 0; b--) {
+                    right_box = aabb(right_box, bins[b]);
+                    right_count += counts[b];
+                    right_boxes[b] = right_box;
+                    right_counts[b] = right_count;
+                }
+
+                aabb left_box;
+                size_t left_count = 0;
+                for(int b = 0; b < bin_count - 1; b++) {
+                    left_box = aabb(left_box, bins[b]);
+                    left_count += counts[b];
+                    if(left_count == 0 || right_counts[b + 1] == 0) continue;
+                    double cost = left_box.surface_area() * left_count + right_boxes[b + 1].surface_area() * right_counts[b + 1];
+                    if(cost < best.cost) {
+                        best.cost = cost;
+                        best.axis = axis;
+                        best.bin = b;
+                        best.overlap = overlap(left_box, right_boxes[b + 1]).surface_area();
+                    }
+                }
+            }
+            return best;
+        }
+
+        /// @brief Find the best binned SAH split of the node's box by planes, clipping the references.
+        /// Each reference is cut into the bins it spans and counted where it enters and leaves.
+        /// @param refs References.
+        /// @param box Box of the node.
+        /// @return Best split.
+        split spatial_split(const std::vector<reference>& refs, const aabb& box) const {
+            split best;
+            best.spatial = true;
+            for(int axis = 0; axis < 3; axis++) {
+                const interval& range = box.axis(axis);
+                if(range.size() <= 0) continue;
+                double scale = bin_count / range.size();
+
+                aabb bins[bin_count];
+                size_t entries[bin_count] = {}, exits[bin_count] = {};
+                for(const reference& ref : refs) {
+                    int first = bin_of(ref.box.axis(axis).min, range.min, scale);
+                    int last = bin_of(ref.box.axis(axis).max, range.min, scale);
+                    reference rest = ref;
+                    for(int b = first; b < last; b++) {
+                        aabb left_part, right_part;
+                        clip(rest, axis, plane(range, b + 1), left_part, right_part);
+                        bins[b] = aabb(bins[b], left_part);
+                        rest.box = right_part;
+                    }
+                    bins[last] = aabb(bins[last], rest.box);
+                    entries[first]++;
+                    exits[last]++;
+                }
+
+                aabb right_boxes[bin_count];
+                size_t right_counts[bin_count];
+                aabb right_box;
+                size_t right_count = 0;
+                for(int b = bin_count - 1; b > 0; b--) {
+                    right_box = aabb(right_box, bins[b]);
+                    right_count += exits[b];
+                    right_boxes[b] = right_box;
+                    right_counts[b] = right_count;
+                }
+
+                aabb left_box;
+                size_t left_count = 0;
+                for(int b = 0; b < bin_count - 1; b++) {
+                    left_box = aabb(left_box, bins[b]);
+                    left_count += entries[b];
+                    if(left_count == 0 || right_counts[b + 1] == 0) continue;
+                    double cost = left_box.surface_area() * left_count + right_boxes[b + 1].surface_area() * right_counts[b + 1];
+                    if(cost < best.cost) {
+                        best.cost = cost;
+                        best.axis = axis;
+                        best.bin = b;
+                    }
+                }
+            }
+            return best;
+        }
+
+        /// @brief Send the references to the sides of a spatial split, cutting the ones that cross it.
+        /// @param refs References.
+        /// @param box Box of the node.
+        /// @param best Split.
+        /// @param left References of the left child.
+        /// @param right References of the right child.
+        /// @return False, with nothing changed, if the cuts would go over the duplication budget.
+        bool partition_spatial(const std::vector<reference>& refs, const aabb& box, const split& best,
+                               std::vector<reference>& left, std::vector<reference>& right) {
+            int axis = best.axis;
+            double position = plane(box.axis(axis), best.bin + 1);
+
+            size_t crossing = 0;
+            for(const reference& ref : refs)
+                if(ref.box.axis(axis).min < position && position < ref.box.axis(axis).max) crossing++;
+            if(crossing > budget) return false;
+
+            for(const reference& ref : refs) {
+                const interval& extent = ref.box.axis(axis);
+                if(extent.max <= position) {
+                    left.push_back(ref);
+                } else if(extent.min >= position) {
+                    right.push_back(ref);
+                } else {
+                    aabb left_part, right_part;
+                    clip(ref, axis, position, left_part, right_part);
+                    if(left_part.surface_area() > 0 || is_box(left_part)) left.push_back({ref.prim, left_part});
+                    if(right_part.surface_area() > 0 || is_box(right_part)) right.push_back({ref.prim, right_part});
+                }
+            }
+
+            if(left.empty() || right.empty()) {
+                left.clear();
+                right.clear();
+                return false;
+            }
+            budget -= std::min(budget, left.size() + right.size() - refs.size());
+            return true;
+        }
+
+        /// @brief Send the references to the sides of an object split by their centroids.
+        /// @param refs References.
+        /// @param centroid_box Box of the references' centroids.
+        /// @param best Split.
+        /// @param left References of the left child.
+        /// @param right References of the right child.
+        /// @return False if either side would be empty.
+        bool partition_object(const std::vector<reference>& refs, const aabb& centroid_box, const split& best,
+                              std::vector<reference>& left, std::vector<reference>& right) const {
+            const interval& range = centroid_box.axis(best.axis);
+            double scale = bin_count / range.size();
+            for(const reference& ref : refs) {
+                if(bin_of(ref.box.center()[best.axis], range.min, scale) <= best.bin) left.push_back(ref);
+                else right.push_back(ref);
+            }
+            if(!left.empty() && !right.empty()) return true;
+            left.clear();
+            right.clear();
+            return false;
+        }
+
+        /// @brief Split the references in two halves by their centroids along the widest axis.
+        /// @param refs References, reordered.
+        /// @param centroid_box Box of the references' centroids.
+        /// @param left References of the left child.
+        /// @param right References of the right child.
+        static void partition_median(std::vector<reference>& refs, const aabb& centroid_box,
+                                     std::vector<reference>& left, std::vector<reference>& right) {
+            int axis = 0;
+            for(int a = 1; a < 3; a++)
+                if(centroid_box.axis(a).size() > centroid_box.axis(axis).size()) axis = a;
+
+            size_t mid = refs.size() / 2;
+            std::nth_element(refs.begin(), refs.begin() + mid, refs.end(), [axis](const reference& a, const reference& b) {
+                return a.box.center()[axis] < b.box.center()[axis];
+            });
+            left.assign(refs.begin(), refs.begin() + mid);
+            right.assign(refs.begin() + mid, refs.end());
+        }
+
+        /// @brief Cut a reference at a plane, keeping the boxes of the triangle's parts on each side.
+        /// @param ref Reference.
+        /// @param axis Axis of the plane.
+        /// @param position Position of the plane.
+        /// @param left_part Box of the part below the plane, inside the reference's box.
+        /// @param right_part Box of the part above the plane, inside the reference's box.
+        void clip(const reference& ref, int axis, double position, aabb& left_part, aabb& right_part) const {
+            const auto& v = (*tris)[ref.prim];
+            left_part = aabb();
+            right_part = aabb();
+
+            for(int i = 0; i < 3; i++) {
+                const point3& v0 = v[i];
+                const point3& v1 = v[(i + 1) % 3];
+                double d0 = v0[axis], d1 = v1[axis];
+
+                if(d0 <= position) left_part = aabb(left_part, aabb(v0, v0));
+                if(d0 >= position) right_part = aabb(right_part, aabb(v0, v0));
+
+                if((d0 < position && position < d1) || (d1 < position && position < d0)) {
+                    point3 p = v0 + (position - d0) / (d1 - d0) * (v1 - v0);
+                    p[axis] = position;
+                    left_part = aabb(left_part, aabb(p, p));
+                    right_part = aabb(right_part, aabb(p, p));
+                }
+            }
+
+            left_part = overlap(left_part.pad(), ref.box);
+            right_part = overlap(right_part.pad(), ref.box);
+        }
+
+        /// @brief Get the intersection of two boxes.
+        static aabb overlap(const aabb& a, const aabb& b) {
+            return aabb(interval(std::max(a.x.min, b.x.min), std::min(a.x.max, b.x.max)),
+                        interval(std::max(a.y.min, b.y.min), std::min(a.y.max, b.y.max)),
+                        interval(std::max(a.z.min, b.z.min), std::min(a.z.max, b.z.max)));
+        }
+
+        static bool is_box(const aabb& box) {
+            return box.x.size() >= 0 && box.y.size() >= 0 && box.z.size() >= 0;
+        }
+
+        static double plane(const interval& range, int b) {
+            return range.min + range.size() * b / bin_count;
+        }
+
+        static int bin_of(double c, double min, double scale) {
+            int b = int((c - min) * scale);
+            return b < 0 ? 0 : (b >= bin_count ? bin_count - 1 : b);
+        }
+};
+
+/// @brief Build a hierarchy with spatial splits over the faces of a mesh, see sbvh_builder.
+/// The hierarchy keeps the builder, so its rebuilds split space too.
+/// @param faces Triangles, as returned by obj::get_triangle_faces.
+/// @param max_growth Extra references allowed, as a fraction of the triangle count.
+/// @return Hierarchy over the triangles.
+inline shared_ptr<flat_bvh> make_spatial_bvh(const std::vector<triangle>& faces, double max_growth = 0.5) {
+    std::vector<shared_ptr<hittable>> objects;
+    objects.reserve(faces.size());
+    for(const triangle& face : faces)
+        objects.push_back(make_shared<triangle>(face));
+
+    // The objects are the triangles made above, read their current vertices on every build.
+    auto build = [max_growth](const std::vector<shared_ptr<hittable>>& triangles, bvh_tree& tree) {
+        std::vector<std::array<point3, 3>> vertices;
+        vertices.reserve(triangles.size());
+        for(const auto& object : triangles) {
+            const triangle& face = static_cast<const triangle&>(*object);
+            vertices.push_back({face.A.coord, face.B.coord, face.C.coord});
+        }
+
+        sbvh_builder builder;
+        builder.max_growth = max_growth;
+        builder.build(vertices, tree);
+    };
+    return make_shared<flat_bvh>(objects, build);
+}
+
+#endif
@@ -0,0 +1,264 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "flat_bvh.hpp"
+#include "sphere.hpp"
+#include "triangle.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+/// @brief Type of the primitive a scene reference points to.
+enum class prim_type : uint32_t { sphere = 0, triangle = 1, extension = 2 };
+
+/// @brief Reference to a primitive of a scene, with the type in the top two bits and
+/// the index in that type's array in the other thirty.
+struct prim_ref {
+    static const uint32_t max_index = (1u << 30) - 1; //!< Largest index that fits next to the type.
+
+    uint32_t bits;
+
+    /// @brief Constructor.
+    /// @param type Type of the primitive.
+    /// @param index Index of the primitive in its type's array.
+    prim_ref(prim_type type, uint32_t index) : bits(uint32_t(type) << 30 | index) {
+        if(index > max_index) {
+            std::clog << "> Error: more than " << max_index + 1 << " primitives of one type in a scene!\n";
+            exit(1);
+        }
+    }
+
+    /// @brief Get the type of the primitive.
+    /// @return Type.
+    prim_type type() const { return prim_type(bits >> 30); }
+
+    /// @brief Get the index of the primitive in its type's array.
+    /// @return Index.
+    uint32_t index() const { return bits & 0x3fffffff; }
+};
+
+/// @brief World that stores its spheres and triangles by value, in one contiguous array per type,
+/// under a single hierarchy. Leaves reference primitives by type and index, and the traversal
+/// switches on the type, so sphere and triangle tests are direct calls the compiler can inline.
+/// Any other hittable, like an instance or a mesh, is kept as an extension behind a pointer and
+/// reached through the virtual interface.
+class scene : public hittable {
+    public:
+        double rebuild_threshold = 1.5; //!< SAH cost growth, relative to the last build, that makes update rebuild.
+
+        /// @brief Add a sphere.
+        /// @param s Sphere.
+        /// @return Index of the sphere, for get_sphere.
+        size_t add(const sphere& s) {
+            sphere_slots.push_back(uint32_t(spheres.size()));
+            spheres.push_back(s);
+            return sphere_slots.size() - 1;
+        }
+
+        /// @brief Add a triangle.
+        /// @param t Triangle.
+        /// @return Index of the triangle, for get_triangle.
+        size_t add(const triangle& t) {
+            triangle_slots.push_back(uint32_t(triangles.size()));
+            triangles.push_back(t);
+            return triangle_slots.size() - 1;
+        }
+
+        /// @brief Add any other hittable, tested through its virtual methods.
+        /// @param object Object.
+        void add(shared_ptr<hittable> object) { extensions.push_back(object); }
+
+        /// @brief Build the hierarchy over every primitive, and store each type's array in leaf order.
+        /// Needs to be called after adding primitives and before hitting the scene.
+        void build() {
+            std::vector<aabb> boxes;
+            std::vector<prim_ref> added;
+            boxes.reserve(size());
+            added.reserve(size());
+            for(uint32_t i = 0; i < spheres.size(); i++) {
+                boxes.push_back(spheres[i].bounding_box());
+                added.push_back(prim_ref(prim_type::sphere, i));
+            }
+            for(uint32_t i = 0; i < triangles.size(); i++) {
+                boxes.push_back(triangles[i].bounding_box());
+                added.push_back(prim_ref(prim_type::triangle, i));
+            }
+            for(uint32_t i = 0; i < extensions.size(); i++) {
+                boxes.push_back(extensions[i]->bounding_box());
+                added.push_back(prim_ref(prim_type::extension, i));
+            }
+
+            bbox = aabb();
+            for(const aabb& box : boxes)
+                bbox = aabb(bbox, box);
+            tree.build(boxes);
+            built_cost = tree.sah_cost();
+
+            // Index in add order of the primitive in each slot, to follow it to its new slot.
+            std::vector<uint32_t> sphere_ids = added_order(sphere_slots);
+            std::vector<uint32_t> triangle_ids = added_order(triangle_slots);
+
+            // Move every primitive to the next free slot of its type's array, in leaf order.
+            std::vector<sphere> ordered_spheres;
+            std::vector<triangle> ordered_triangles;
+            std::vector<shared_ptr<hittable>> ordered_extensions;
+            ordered_spheres.reserve(spheres.size());
+            ordered_triangles.reserve(triangles.size());
+            ordered_extensions.reserve(extensions.size());
+            refs.clear();
+            refs.reserve(added.size());
+            for(uint32_t index : tree.prim_indices) {
+                prim_ref ref = added[index];
+                switch(ref.type()) {
+                    case prim_type::sphere:
+                        sphere_slots[sphere_ids[ref.index()]] = uint32_t(ordered_spheres.size());
+                        refs.push_back(prim_ref(prim_type::sphere, uint32_t(ordered_spheres.size())));
+                        ordered_spheres.push_back(spheres[ref.index()]);
+                        break;
+                    case prim_type::triangle:
+                        triangle_slots[triangle_ids[ref.index()]] = uint32_t(ordered_triangles.size());
+                        refs.push_back(prim_ref(prim_type::triangle, uint32_t(ordered_triangles.size())));
+                        ordered_triangles.push_back(triangles[ref.index()]);
+                        break;
+                    default:
+                        refs.push_back(prim_ref(prim_type::extension, uint32_t(ordered_extensions.size())));
+                        ordered_extensions.push_back(extensions[ref.index()]);
+                }
+            }
+            spheres.swap(ordered_spheres);
+            triangles.swap(ordered_triangles);
+            extensions.swap(ordered_extensions);
+
+            // The references replace the tree's own index buffer.
+            tree.prim_indices.clear();
+            tree.prim_indices.shrink_to_fit();
+        }
+
+        /// @brief Prepare the hierarchy for a new frame after primitives moved.
+        /// Refits the boxes in one linear pass, and only rebuilds when the refit tree's
+        /// SAH cost has grown past rebuild_threshold times the cost right after the last build.
+        /// @return True if the hierarchy was rebuilt.
+        bool update() {
+            // Primitives are stored in leaf order, so the box of tree position p is the box of refs[p].
+            std::vector<aabb> boxes(refs.size());
+            bbox = aabb();
+            for(size_t p = 0; p < refs.size(); p++) {
+                boxes[p] = visit_box(refs[p]);
+                bbox = aabb(bbox, boxes[p]);
+            }
+
+            // The refit looks boxes up through the index buffer build dropped, which is the identity here.
+            tree.prim_indices.resize(refs.size());
+            std::iota(tree.prim_indices.begin(), tree.prim_indices.end(), 0);
+            tree.refit(boxes);
+            tree.prim_indices.clear();
+            tree.prim_indices.shrink_to_fit();
+
+            if(tree.sah_cost() <= rebuild_threshold * built_cost)
+                return false;
+
+            build();
+            return true;
+        }
+
+        /// @brief Get a sphere to change it, like moving it with sphere::set_center.
+        /// The scene needs an update before it is hit again.
+        /// @param i Index returned when the sphere was added.
+        /// @return Sphere.
+        sphere& get_sphere(size_t i) { return spheres[sphere_slots[i]]; }
+
+        /// @brief Get a triangle to change it, like moving it with triangle::set_vertices.
+        /// The scene needs an update before it is hit again.
+        /// @param i Index returned when the triangle was added.
+        /// @return Triangle.
+        triangle& get_triangle(size_t i) { return triangles[triangle_slots[i]]; }
+
+        /// @brief Finds the closest primitive hit by a ray.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @param rec Hit record.
+        /// @return True if the ray hits some primitive.
+        bool intersect(const ray& r, interval ray_t, hit_record& rec) const override {
+            return tree.traverse(r, ray_t, [&](uint32_t p, interval& t) {
+                bool hit = visit(refs[p], [&](const auto& prim) {
+                    // Spheres and triangles always record themselves, extensions may not.
+                    if constexpr(std::is_same_v<std::decay_t<decltype(prim)>, hittable>)
+                        return intersect_child(prim, r, t, rec);
+                    else
+                        return prim.intersect(r, t, rec);
+                });
+                if(!hit) return false;
+                t.max = rec.t;
+                return true;
+            });
+        }
+
+        /// @brief Decides if any primitive blocks a ray, stopping at the first one found.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @return True if the ray hits some primitive.
+        bool occluded(const ray& r, interval ray_t) const override {
+            return tree.traverse<true>(r, ray_t, [&](uint32_t p, interval& t) {
+                return visit(refs[p], [&](const auto& prim) { return prim.occluded(r, t); });
+            });
+        }
+
+        /// @brief Get the scene's bounding box, as of the last build.
+        /// @return Box that encloses every primitive.
+        aabb bounding_box() const override { return bbox; }
+
+        /// @brief Get the number of primitives.
+        /// @return Number of spheres, triangles and extensions.
+        size_t size() const { return spheres.size() + triangles.size() + extensions.size(); }
+
+    private:
+        std::vector<sphere> spheres;
+        std::vector<triangle> triangles;
+        std::vector<shared_ptr<hittable>> extensions;
+        std::vector<uint32_t> sphere_slots; // Slot in spheres of each sphere, in add order.
+        std::vector<uint32_t> triangle_slots; // Slot in triangles of each triangle, in add order.
+        std::vector<prim_ref> refs; // Primitive at each tree position.
+        bvh_tree tree;
+        aabb bbox;
+        double built_cost = 0; // SAH cost right after the last build.
+
+        /// @brief Invert a slot table.
+        /// @param slots Slot of each primitive, in add order.
+        /// @return Index in add order of the primitive in each slot.
+        static std::vector<uint32_t> added_order(const std::vector<uint32_t>& slots) {
+            std::vector<uint32_t> ids(slots.size());
+            for(uint32_t i = 0; i < slots.size(); i++)
+                ids[slots[i]] = i;
+            return ids;
+        }
+
+        /// @brief Get the current box of the primitive a reference points to.
+        /// @param ref Reference.
+        /// @return Box.
+        aabb visit_box(prim_ref ref) const {
+            switch(ref.type()) {
+                case prim_type::sphere: return spheres[ref.index()].bounding_box();
+                case prim_type::triangle: return triangles[ref.index()].bounding_box();
+                default: return extensions[ref.index()]->bounding_box();
+            }
+        }
+
+        /// @brief Call a function with the primitive a reference points to, as its own type.
+        /// @param ref Reference.
+        /// @param f Function, called with a sphere, a triangle or a hittable.
+        /// @return What the function returns.
+        template <class F>
+        bool visit(prim_ref ref, F&& f) const {
+            switch(ref.type()) {
+                case prim_type::sphere: return f(spheres[ref.index()]);
+                case prim_type::triangle: return f(triangles[ref.index()]);
+                default: return f(*extensions[ref.index()]);
+            }
+        }
+};
+
+#endif
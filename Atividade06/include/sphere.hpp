@@ -4,21 +4,81 @@
 #include "hittable.hpp"
 
 /// @brief Hittable derived class for a hittable sphere.
-class sphere : public hittable {
+class sphere final : public hittable {
     public:
         /// @brief Constructor.
         /// @param _center Sphere's center coordinates.
         /// @param _radius Sphere's radius.
         /// @param _mat Sphere's material.
-        sphere(const point3& _center, double _radius, shared_ptr<material> _mat): 
-            center(_center), radius(_radius), mat(_mat) {}
+        sphere(const point3& _center, double _radius, const material* _mat): 
+            center(_center), radius(_radius), mat(_mat) {
+            vec3 rvec = vec3(radius, radius, radius);
+            bbox = aabb(center - rvec, center + rvec);
+        }
 
-        /// @brief Method for deciding a hit.
+        /// @brief Method for finding a hit.
         /// @param r Ray.
         /// @param ray_t Valid ray interval.
         /// @param rec Hit record.
         /// @return True if the ray hits the sphere or false if it doesn't.
-        bool hit(const ray& r, interval ray_t, hit_record& rec) const override {
+        bool intersect(const ray& r, interval ray_t, hit_record& rec) const override {
+            double root;
+            if(!find_root(r, ray_t, root)) return false;
+
+            // Record hit
+            rec.t = root;
+            rec.object = this;
+            return true;
+        }
+
+        /// @brief Method for filling the surface attributes of a hit.
+        /// @param r Ray.
+        /// @param rec Hit record.
+        void finalize(const ray& r, hit_record& rec) const override {
+            rec.p = r.at(rec.t);
+            vec3 outward_normal = (rec.p - center) / radius;
+            rec.set_face_normal(r, outward_normal);
+            rec.mat = mat;
+        }
+
+        /// @brief Method for deciding if the sphere blocks a ray.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @return True if the ray hits the sphere.
+        bool occluded(const ray& r, interval ray_t) const override {
+            double root;
+            return find_root(r, ray_t, root);
+        }
+
+        /// @brief Get the sphere's bounding box.
+        /// @return Box that encloses the sphere.
+        aabb bounding_box() const override { return bbox; }
+
+        /// @brief Move the sphere, for animation.
+        /// Hierarchies over it need to be refit afterwards.
+        /// @param _center New center coordinates.
+        void set_center(const point3& _center) {
+            center = _center;
+            vec3 rvec = vec3(radius, radius, radius);
+            bbox = aabb(center - rvec, center + rvec);
+        }
+
+        /// @brief Get the sphere's center.
+        /// @return Center coordinates.
+        const point3& get_center() const { return center; }
+
+    private:
+        point3 center;
+        double radius;
+        const material* mat;
+        aabb bbox;
+
+        /// @brief Find the nearest intersection of a ray with the sphere.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @param root Distance of the intersection along the ray.
+        /// @return True if there is an intersection inside the interval.
+        bool find_root(const ray& r, const interval& ray_t, double& root) const {
             vec3 oc = r.origin() - center;
             auto a = r.direction().length_squared();
             auto half_b = dot(oc, r.direction());
@@ -29,27 +89,14 @@ class sphere : public hittable {
             auto sqrtd = sqrt(discriminant);
 
             // This guarantees sense of depth between multiple objects.
-            auto root = (-half_b - sqrtd) / a;
+            root = (-half_b - sqrtd) / a;
             if(!ray_t.surrounds(root)) {
                 root = (-half_b + sqrtd) / a;
                 if(!ray_t.surrounds(root))
                     return false;
             }
-
-            // Record hit
-            rec.t = root;
-            rec.p = r.at(rec.t);
-            vec3 outward_normal = (rec.p - center) / radius;
-            rec.set_face_normal(r, outward_normal);
-            rec.mat = mat;
-
             return true;
         }
-
-    private:
-        point3 center;
-        double radius;
-        shared_ptr<material> mat;
 };
 
 #endif
\ No newline at end of file
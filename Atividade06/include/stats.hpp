@@ -0,0 +1,24 @@
+#ifndef STATS_H
+#define STATS_H
+
+/// @brief Counters of acceleration structure traversals, per thread.
+/// They are only updated in builds that define BVH_STATS, like the benchmarks.
+struct traversal_stats {
+    unsigned long long nodes_visited = 0; //!< Nodes whose box was tested against a ray.
+    unsigned long long primitives_tested = 0; //!< Primitives tested against a ray.
+};
+
+/// @brief Get the traversal counters of the calling thread.
+/// @return Counters.
+inline traversal_stats& thread_traversal_stats() {
+    static thread_local traversal_stats stats;
+    return stats;
+}
+
+#ifdef BVH_STATS
+#define BVH_COUNT(counter) (++thread_traversal_stats().counter)
+#else
+#define BVH_COUNT(counter) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// @brief Pool of worker threads with one task queue per worker and work stealing.
+/// Each worker takes tasks from the back of its own queue and, when it runs dry,
+/// steals from the front of the other queues, so expensive tasks don't leave cores idle.
+class thread_pool {
+    public:
+        /// @brief Constructor.
+        /// @param num_threads Number of workers (0 uses all hardware threads).
+        explicit thread_pool(int num_threads = 0) {
+            if(num_threads <= 0)
+                num_threads = static_cast<int>(std::thread::hardware_concurrency());
+            if(num_threads <= 0)
+                num_threads = 1;
+
+            for(int i = 0; i < num_threads; ++i)
+                queues.push_back(std::make_unique<task_queue>());
+            for(int i = 0; i < num_threads; ++i)
+                workers.emplace_back([this, i] { worker_loop(i); });
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        /// @brief Destructor, waits for pending tasks and joins all workers.
+        ~thread_pool() {
+            {
+                std::lock_guard<std::mutex> lock(state_mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for(std::thread& worker : workers)
+                worker.join();
+        }
+
+        /// @brief Get number of workers.
+        /// @return Number of workers.
+        int size() const { return static_cast<int>(workers.size()); }
+
+        /// @brief Add a task, queues are filled round-robin.
+        /// @param task Task to be run by some worker.
+        void submit(std::function<void()> task) {
+            size_t id = next_queue++ % queues.size();
+            // Count the task before publishing it, a worker may take and finish it right away.
+            {
+                std::lock_guard<std::mutex> lock(state_mutex);
+                ++queued;
+                ++unfinished;
+            }
+            {
+                std::lock_guard<std::mutex> lock(queues[id]->m);
+                queues[id]->tasks.push_back(std::move(task));
+            }
+            wake.notify_one();
+        }
+
+        /// @brief Block until every submitted task has finished.
+        /// If some task threw, rethrows the first exception once all of them are done.
+        /// Must not be called from a task of the same pool, which would wait for itself.
+        void wait() {
+            assert(current_pool() != this && "thread_pool::wait called from one of its own tasks");
+
+            std::unique_lock<std::mutex> lock(state_mutex);
+            done.wait(lock, [this] { return unfinished == 0; });
+            if(failure) {
+                std::exception_ptr thrown = failure;
+                failure = nullptr;
+                std::rethrow_exception(thrown);
+            }
+        }
+
+    private:
+        struct task_queue {
+            std::mutex m;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        std::vector<std::unique_ptr<task_queue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<size_t> next_queue{0};
+
+        std::mutex state_mutex;
+        std::condition_variable wake; // Signals workers that there are tasks.
+        std::condition_variable done; // Signals waiters that all tasks finished.
+        std::atomic<size_t> queued{0}; // Tasks waiting in some queue.
+        size_t unfinished = 0; // Tasks submitted but not yet finished.
+        std::exception_ptr failure; // First exception thrown by a task since the last wait.
+        bool stopping = false;
+
+        /// @brief Get the pool whose worker is the calling thread.
+        /// @return Pool, or null outside of workers.
+        static const thread_pool*& current_pool() {
+            static thread_local const thread_pool* pool = nullptr;
+            return pool;
+        }
+
+        /// @brief Take a task from the worker's own queue or steal one from another worker.
+        /// @param id Worker index.
+        /// @param task Taken task.
+        /// @return True if a task was taken.
+        bool take_task(size_t id, std::function<void()>& task) {
+            {
+                std::lock_guard<std::mutex> lock(queues[id]->m);
+                if(!queues[id]->tasks.empty()) {
+                    task = std::move(queues[id]->tasks.back());
+                    queues[id]->tasks.pop_back();
+                    --queued;
+                    return true;
+                }
+            }
+
+            for(size_t n = 1; n < queues.size(); ++n) {
+                task_queue& victim = *queues[(id + n) % queues.size()];
+                std::lock_guard<std::mutex> lock(victim.m);
+                if(!victim.tasks.empty()) {
+                    task = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                    --queued;
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        /// @brief Main loop of a worker.
+        /// @param id Worker index.
+        void worker_loop(size_t id) {
+            current_pool() = this;
+            while(true) {
+                std::function<void()> task;
+                if(take_task(id, task)) {
+                    // An exception must not end the worker, it is handed to wait instead.
+                    std::exception_ptr thrown;
+                    try {
+                        task();
+                    } catch(...) {
+                        thrown = std::current_exception();
+                    }
+
+                    std::lock_guard<std::mutex> lock(state_mutex);
+                    if(thrown && !failure)
+                        failure = thrown;
+                    if(--unfinished == 0)
+                        done.notify_all();
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(state_mutex);
+                wake.wait(lock, [this] { return stopping || queued > 0; });
+                if(stopping && queued == 0)
+                    return;
+            }
+        }
+};
+
+#endif
@@ -6,8 +6,9 @@
 #include <tuple>
 
 /// @brief Hittable derived class for a hittable triangle.
-class triangle : public hittable {
+class triangle final : public hittable {
     public:
+        // Change the vertices through set_vertices, which also updates the normal and the box.
         vertex A;
         vertex B;
         vertex C;
@@ -16,11 +17,12 @@ class triangle : public hittable {
         /// @param _A Vertex A.
         /// @param _B Vertex B.
         /// @param _C Vertex C.
-        triangle(const vertex& _A, const vertex& _B, const vertex& _C, shared_ptr<material> _mat): 
+        triangle(const vertex& _A, const vertex& _B, const vertex& _C, const material* _mat): 
             A(_A), B(_B), C(_C), mat(_mat) {
             vec3 u = B.coord - A.coord;
             vec3 v = C.coord - A.coord;
             normal = cross(u, v);
+            bbox = corner_box();
         }
         
         /// @brief Constructor with normal setting to avoid normal recalculation.
@@ -29,71 +31,119 @@ class triangle : public hittable {
         /// @param _C Vertex C.
         /// @param _normal Triangle's normal.
         triangle(const vertex& _A, const vertex& _B, const vertex& _C, 
-                const vec3& _normal, shared_ptr<material> _mat):
-            A(_A), B(_B), C(_C), normal(_normal), mat(_mat) {}
+                const vec3& _normal, const material* _mat):
+            A(_A), B(_B), C(_C), normal(_normal), mat(_mat), bbox(corner_box()) {}
         
-        /// @brief Method for deciding a hit.
+        /// @brief Method for finding a hit.
         /// @param r Ray.
         /// @param ray_t Valid ray interval.
         /// @param rec Hit record.
         /// @return True if the ray hits the triangle or false if it doesn't.
-        bool hit(const ray& r, interval ray_t, hit_record& rec) const override {
-            /* Find the point in which the ray intersects with the triangle's plane */
-            // But if normal * d = 0, the ray is parallel to the plane
-            double nd = dot(normal, r.direction());
-            if(fabs(nd) < 1e-8) return false;
-
-            double D = dot(normal, A.coord);
-            double t = (D - dot(normal, r.origin())) / nd;
-            
-            // If t < 0, the plane is behind the ray, which is invalid
-            if(t < 0) return false;
+        bool intersect(const ray& r, interval ray_t, hit_record& rec) const override {
+            double t, u, v; //barycentric coordinates of B and C
+            if(!intersect(A.coord, B.coord, C.coord, r, ray_t, t, u, v)) return false;
 
-            // This guarantees sense of depth between multiple objects.
-            if(!ray_t.surrounds(t)) return false;
+            // Record hit
+            rec.t = t;
+            rec.u = u;
+            rec.v = v;
+            rec.object = this;
+            return true;
+        }
+
+        /// @brief Method for filling the surface attributes of a hit.
+        /// @param r Ray.
+        /// @param rec Hit record.
+        void finalize(const ray& r, hit_record& rec) const override {
+            rec.p = r.at(rec.t);
+            vec3 color_normal = unit_vector(A.normal*(1.0 - rec.u - rec.v) + B.normal*rec.u + C.normal*rec.v);
+            // Decide surface's front face with the triangle's normal,
+            // but use calculated normal from barycentric coordinates for the color.
+            rec.set_face_normal(r, normal, color_normal);
+            rec.mat = mat;
+        }
+
+        /// @brief Method for deciding if the triangle blocks a ray.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @return True if the ray hits the triangle.
+        bool occluded(const ray& r, interval ray_t) const override {
+            double t, u, v;
+            return intersect(A.coord, B.coord, C.coord, r, ray_t, t, u, v);
+        }
 
-            // Intersection
-            point3 P = r.at(t);
+        /// @brief Get the triangle's bounding box.
+        /// @return Box that encloses the triangle, padded so it's never flat.
+        aabb bounding_box() const override { return bbox; }
 
-            /* Now, check if the intersection point is inside the triangle */
-            double w0, w1, w2; //barycentric coordinates
+        /// @brief Move the triangle's vertices, for animation.
+        /// Hierarchies over it need to be refit afterwards.
+        /// @param _A Vertex A.
+        /// @param _B Vertex B.
+        /// @param _C Vertex C.
+        void set_vertices(const vertex& _A, const vertex& _B, const vertex& _C) {
+            A = _A;
+            B = _B;
+            C = _C;
+            normal = cross(B.coord - A.coord, C.coord - A.coord);
+            bbox = corner_box();
+        }
 
-            // Check edge AB
-            vec3 AB = B.coord - A.coord, AP = P - A.coord;
-            vec3 ABxAP = cross(AB, AP);
-            if(dot(normal, ABxAP) < 0) return false;
+        /// @brief Find the intersection of a ray with a triangle, watertight.
+        /// The corners are moved into the ray's shear frame (see ray::shear_factors), where the
+        /// ray is the z axis, and the test becomes three 2D edge functions at the origin. An edge
+        /// shared by two triangles gives the same value with opposite signs in both, so no ray
+        /// slips between them, and the test rejects as soon as two of them disagree in sign.
+        /// Shared with triangle_mesh, which stores only vertex indices.
+        /// @param A Corner A.
+        /// @param B Corner B.
+        /// @param C Corner C.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @param t Distance of the intersection along the ray.
+        /// @param u Barycentric coordinate of corner B.
+        /// @param v Barycentric coordinate of corner C.
+        /// @return True if the ray hits the triangle inside the interval.
+        static bool intersect(const point3& A, const point3& B, const point3& C,
+                              const ray& r, const interval& ray_t, double& t, double& u, double& v) {
+            const point3& o = r.origin();
+            const vec3& S = r.shear_factors();
+            int kx = r.shear_axis(0), ky = r.shear_axis(1), kz = r.shear_axis(2);
 
-            // Check edge BC
-            vec3 BC = C.coord - B.coord, BP = P - B.coord;
-            vec3 BCxBP = cross(BC, BP);
-            w0 = dot(normal, BCxBP); //store this value
-            if(w0 < 0) return false;
+            // Corners relative to the origin, sheared so the ray runs along z.
+            double Az = A[kz] - o[kz], Bz = B[kz] - o[kz], Cz = C[kz] - o[kz];
+            double Ax = A[kx] - o[kx] - S[0] * Az, Ay = A[ky] - o[ky] - S[1] * Az;
+            double Bx = B[kx] - o[kx] - S[0] * Bz, By = B[ky] - o[ky] - S[1] * Bz;
+            double Cx = C[kx] - o[kx] - S[0] * Cz, Cy = C[ky] - o[ky] - S[1] * Cz;
 
-            // Check edge CA
-            vec3 CA = A.coord - C.coord, CP = P - C.coord;
-            vec3 CAxCP = cross(CA, CP);
-            w1 = dot(normal, CAxCP); //store this value
-            if(w1 < 0) return false;
+            // Edge functions, the unnormalized barycentric weights of A, B and C.
+            double U = Cx * By - Cy * Bx;
+            double V = Ax * Cy - Ay * Cx;
+            if((U < 0 || V < 0) && (U > 0 || V > 0)) return false;
+            double W = Bx * Ay - By * Ax;
+            if((U < 0 || V < 0 || W < 0) && (U > 0 || V > 0 || W > 0)) return false;
 
-            double denom = normal.length_squared();
-            w2 = 1.0 - w0/denom - w1/denom;
+            // Zero when the ray lies in the triangle's plane.
+            double det = U + V + W;
+            if(det == 0) return false;
 
-            // Record hit
-            rec.t = t;
-            rec.p = P;
-            vec3 color_normal = unit_vector(A.normal*w0 + B.normal*w1 + C.normal*w2);
-            // Decide surface's front face with the triangle's normal,
-            // but use calculated normal from barycentric coordinates for the color.
-            rec.set_face_normal(r, normal, color_normal);
-            rec.mat = mat;
+            // This guarantees sense of depth between multiple objects.
+            t = (U * Az + V * Bz + W * Cz) * S[2] / det;
+            if(!ray_t.surrounds(t)) return false;
 
-            // Intersection is inside the triangle.
+            u = V / det;
+            v = W / det;
             return true;
         }
 
     private:
         vec3 normal; //triangle's plane normal
-        shared_ptr<material> mat;
+        const material* mat;
+        aabb bbox;
+
+        aabb corner_box() const {
+            return aabb(aabb(A.coord, B.coord), aabb(C.coord, C.coord)).pad();
+        }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,153 @@
+#ifndef TRIANGLE_MESH_H
+#define TRIANGLE_MESH_H
+
+#include "flat_bvh.hpp"
+#include "triangle.hpp"
+
+#include <array>
+
+/// @brief Hittable for a whole triangle mesh, with shared vertex buffers and an index buffer.
+/// Every position and normal is stored once, however many triangles use it, and each triangle
+/// is three indices. The mesh keeps its own hierarchy over the triangles and is hit like one
+/// object, so the world needs a single pointer for the whole mesh.
+class triangle_mesh : public hittable {
+    public:
+        /// @brief Constructor.
+        /// @param _positions Vertex positions.
+        /// @param _normals Vertex normals, empty to shade with the face normals.
+        /// @param _faces Position index of each triangle's corners.
+        /// @param _normal_faces Normal index of each triangle's corners, empty if there are no normals.
+        /// @param _mat Material of the whole mesh.
+        triangle_mesh(std::vector<point3> _positions, std::vector<vec3> _normals,
+                      std::vector<std::array<uint32_t, 3>> _faces, std::vector<std::array<uint32_t, 3>> _normal_faces,
+                      const material* _mat) :
+            positions(std::move(_positions)), normals(std::move(_normals)), faces(std::move(_faces)),
+            normal_faces(std::move(_normal_faces)), mat(_mat) {
+            if(!normal_faces.empty() && normal_faces.size() != faces.size()) {
+                clog << "> Error: triangle mesh needs a normal index for every corner!\n";
+                exit(1);
+            }
+            for(size_t f = 0; f < faces.size(); f++) {
+                for(int k = 0; k < 3; k++) {
+                    if(faces[f][k] >= positions.size() || (!normal_faces.empty() && normal_faces[f][k] >= normals.size())) {
+                        clog << "> Error: triangle mesh index out of range!\n";
+                        exit(1);
+                    }
+                }
+            }
+            build();
+        }
+
+        /// @brief Method for finding the closest triangle hit.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @param rec Hit record, with the face index in prim.
+        /// @return True if the ray hits some triangle.
+        bool intersect(const ray& r, interval ray_t, hit_record& rec) const override {
+            bool hit_anything = tree.traverse(r, ray_t, [&](uint32_t f, interval& range) {
+                double t, u, v;
+                if(!intersect_face(f, r, range, t, u, v)) return false;
+                rec.t = t;
+                rec.u = u;
+                rec.v = v;
+                rec.prim = f;
+                range.max = t;
+                return true;
+            });
+            if(hit_anything) rec.object = this;
+            return hit_anything;
+        }
+
+        /// @brief Method for filling the surface attributes of a hit, shaded like triangle.
+        /// @param r Ray.
+        /// @param rec Hit record.
+        void finalize(const ray& r, hit_record& rec) const override {
+            const vec3& normal = face_normals[rec.prim];
+
+            rec.p = r.at(rec.t);
+            vec3 nA = normal, nB = normal, nC = normal;
+            if(!normal_faces.empty()) {
+                const std::array<uint32_t, 3>& normal_face = normal_faces[rec.prim];
+                nA = normals[normal_face[0]];
+                nB = normals[normal_face[1]];
+                nC = normals[normal_face[2]];
+            }
+            vec3 color_normal = unit_vector(nA*(1.0 - rec.u - rec.v) + nB*rec.u + nC*rec.v);
+            rec.set_face_normal(r, normal, color_normal);
+            rec.mat = mat;
+        }
+
+        /// @brief Decides if any triangle blocks a ray, stopping at the first one found.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @return True if the ray hits some triangle.
+        bool occluded(const ray& r, interval ray_t) const override {
+            return tree.traverse<true>(r, ray_t, [&](uint32_t f, interval& range) {
+                double t, u, v;
+                return intersect_face(f, r, range, t, u, v);
+            });
+        }
+
+        /// @brief Get the mesh's bounding box.
+        /// @return Box that encloses all triangles.
+        aabb bounding_box() const override { return bbox; }
+
+        /// @brief Get the number of triangles.
+        /// @return Number of triangles.
+        size_t size() const { return faces.size(); }
+
+        /// @brief Get the memory used by the buffers and the hierarchy.
+        /// @return Size in bytes.
+        size_t memory_bytes() const {
+            return positions.capacity() * sizeof(point3) + normals.capacity() * sizeof(vec3)
+                 + (faces.capacity() + normal_faces.capacity()) * sizeof(std::array<uint32_t, 3>)
+                 + face_normals.capacity() * sizeof(vec3) + tree.memory_bytes();
+        }
+
+    private:
+        std::vector<point3> positions;
+        std::vector<vec3> normals;
+        std::vector<std::array<uint32_t, 3>> faces; // In the order of the tree's leaves.
+        std::vector<std::array<uint32_t, 3>> normal_faces; // Same order as faces.
+        std::vector<vec3> face_normals; // Same order as faces, so hits don't recompute them.
+        const material* mat;
+        bvh_tree tree;
+        aabb bbox;
+
+        /// @brief Build the hierarchy and reorder the triangles like its leaves.
+        /// Afterwards a position in the tree is the triangle's index, so the tree's own
+        /// index buffer is dropped.
+        void build() {
+            std::vector<aabb> boxes;
+            boxes.reserve(faces.size());
+            for(const std::array<uint32_t, 3>& face : faces) {
+                const point3& A = positions[face[0]];
+                boxes.push_back(aabb(aabb(A, positions[face[1]]), aabb(positions[face[2]], positions[face[2]])).pad());
+                bbox = aabb(bbox, boxes.back());
+            }
+            tree.build(boxes);
+
+            std::vector<std::array<uint32_t, 3>> ordered(faces.size());
+            for(size_t p = 0; p < faces.size(); p++) ordered[p] = faces[tree.prim_indices[p]];
+            faces.swap(ordered);
+            if(!normal_faces.empty()) {
+                for(size_t p = 0; p < normal_faces.size(); p++) ordered[p] = normal_faces[tree.prim_indices[p]];
+                normal_faces.swap(ordered);
+            }
+            tree.prim_indices.clear();
+            tree.prim_indices.shrink_to_fit();
+
+            face_normals.resize(faces.size());
+            for(size_t f = 0; f < faces.size(); f++) {
+                const point3& A = positions[faces[f][0]];
+                face_normals[f] = cross(positions[faces[f][1]] - A, positions[faces[f][2]] - A);
+            }
+        }
+
+        bool intersect_face(uint32_t f, const ray& r, const interval& ray_t, double& t, double& u, double& v) const {
+            const std::array<uint32_t, 3>& face = faces[f];
+            return triangle::intersect(positions[face[0]], positions[face[1]], positions[face[2]], r, ray_t, t, u, v);
+        }
+};
+
+#endif
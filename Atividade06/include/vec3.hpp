@@ -116,7 +116,9 @@ class vec3 {
         /// @brief Generate a random vector.
         /// @return Random vector.
         static vec3 random() {
-            return vec3(random_double(), random_double(), random_double());
+            double u[3];
+            random_doubles(u, 3);
+            return vec3(u[0], u[1], u[2]);
         }
 
         /// @brief Generate a random vector in a interval.
@@ -124,7 +126,9 @@ class vec3 {
         /// @param max Maximum value.
         /// @return Random vector.
         static vec3 random(double min, double max) {
-            return vec3(random_double(min,max), random_double(min,max), random_double(min,max));
+            double u[3];
+            random_doubles(u, 3);
+            return vec3(min + (max - min)*u[0], min + (max - min)*u[1], min + (max - min)*u[2]);
         }
 };
 
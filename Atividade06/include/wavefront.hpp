@@ -0,0 +1,133 @@
+#ifndef WAVEFRONT_H
+#define WAVEFRONT_H
+
+#include "material.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+/// @brief State of one path traced by the wavefront integrator.
+struct path_state {
+    ray r; //!< Current ray of the path.
+    color throughput = color(1, 1, 1); //!< Fraction of light carried back along the path so far.
+    color result = color(0, 0, 0); //!< Color gathered by the path once it ends.
+    pcg32 rng; //!< Random stream of the path.
+};
+
+/// @brief Path tracer that advances a large batch of paths one bounce at a time.
+/// Every bounce first intersects all live rays, then sorts the hits by material
+/// and runs each material's scatter kernel over its own contiguous batch, so the
+/// same code and data stay hot instead of jumping between materials every ray.
+/// The kernels themselves are still scalar (see material::scatter_batch), and
+/// `bench wavefront` compares the integrator with the per-path one.
+class wavefront_integrator {
+    public:
+        int max_depth = 10; //!< Maximum number of ray bounces.
+        int roulette_depth = 3; //!< Bounces after which Russian roulette may end a path (negative disables it).
+
+        /// @brief Trace a batch of paths to completion.
+        /// @param paths Paths with their camera rays and random streams set, results are written to them.
+        /// @param world World.
+        void trace(std::vector<path_state>& paths, const hittable& world) {
+            live.resize(paths.size());
+            std::iota(live.begin(), live.end(), 0);
+            recs.resize(paths.size());
+
+            for(int bounce = 0; bounce < max_depth && !live.empty(); ++bounce) {
+                // Intersection stage: rays that miss everything pick up the sky.
+                hits.clear();
+                for(size_t k : live) {
+                    path_state& path = paths[k];
+                    if(world.hit(path.r, interval(0.001, infinity), recs[k]))
+                        hits.push_back(k);
+                    else
+                        path.result = path.throughput * sky_color(path.r);
+                }
+
+                // Group the hits so that each material sees one contiguous batch.
+                std::sort(hits.begin(), hits.end(), [this](size_t a, size_t b) {
+                    return recs[a].mat < recs[b].mat;
+                });
+
+                // Shading stage, one kernel call per material.
+                live.clear();
+                for(size_t begin = 0; begin < hits.size();) {
+                    const material* mat = recs[hits[begin]].mat;
+                    size_t end = begin;
+                    while(end < hits.size() && recs[hits[end]].mat == mat)
+                        ++end;
+
+                    shade(*mat, paths, begin, end, bounce);
+                    begin = end;
+                }
+            }
+            // Paths still alive here exceeded the bounce limit and gather no light.
+        }
+
+    private:
+        std::vector<size_t> live; // Paths that still need to be traced.
+        std::vector<size_t> hits; // Paths whose current ray hit something.
+        std::vector<hit_record> recs; // Hit record of each path.
+
+        // Gathered inputs and outputs of a material kernel.
+        std::vector<ray> batch_in;
+        std::vector<hit_record> batch_rec;
+        std::vector<pcg32> batch_rng;
+        std::vector<color> batch_attenuation;
+        std::vector<ray> batch_scattered;
+        std::unique_ptr<bool[]> batch_valid;
+        size_t batch_capacity = 0;
+
+        /// @brief Run a material's scatter kernel over a run of hits and update the paths.
+        /// @param mat Material of the hits.
+        /// @param paths Paths.
+        /// @param begin First position of the run in the hit list.
+        /// @param end Position after the last of the run in the hit list.
+        /// @param bounce Current bounce.
+        void shade(const material& mat, std::vector<path_state>& paths, size_t begin, size_t end, int bounce) {
+            size_t n = end - begin;
+            batch_in.resize(n);
+            batch_rec.resize(n);
+            batch_rng.resize(n);
+            batch_attenuation.resize(n);
+            batch_scattered.resize(n);
+            if(batch_capacity < n) {
+                batch_valid.reset(new bool[n]);
+                batch_capacity = n;
+            }
+
+            for(size_t i = 0; i < n; ++i) {
+                size_t k = hits[begin + i];
+                batch_in[i] = paths[k].r;
+                batch_rec[i] = recs[k];
+                batch_rng[i] = paths[k].rng;
+            }
+
+            mat.scatter_batch(n, batch_in.data(), batch_rec.data(), batch_rng.data(),
+                              batch_attenuation.data(), batch_scattered.data(), batch_valid.get());
+
+            for(size_t i = 0; i < n; ++i) {
+                size_t k = hits[begin + i];
+                path_state& path = paths[k];
+                path.rng = batch_rng[i];
+                if(!batch_valid[i]) continue;
+
+                path.throughput = path.throughput * batch_attenuation[i];
+                path.r = batch_scattered[i];
+
+                // Russian roulette, drawing from the path's stream like the scalar integrator.
+                if(roulette_depth >= 0 && bounce >= roulette_depth) {
+                    const color& t = path.throughput;
+                    double survival = fmin(0.95, fmax(t.x(), fmax(t.y(), t.z())));
+                    if(path.rng.next_double() >= survival)
+                        continue;
+                    path.throughput /= survival;
+                }
+
+                live.push_back(k);
+            }
+        }
+};
+
+#endif
@@ -0,0 +1,310 @@
+#ifndef WIDE_BVH_H
+#define WIDE_BVH_H
+
+#include "flat_bvh.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WIDE_BVH_SSE 1
+#endif
+
+/// @brief Node of a 4-wide hierarchy, with the boxes of its children stored axis by axis
+/// (structure of arrays) so that one SSE instruction handles a coordinate of all four.
+/// Unused child slots hold empty boxes, which no ray can hit.
+struct alignas(64) bvh4_node {
+    float lo[3][4]; //!< Box minimum of each child, per axis.
+    float hi[3][4]; //!< Box maximum of each child, per axis.
+    uint32_t child[4]; //!< Inner child: node index. Leaf child: first primitive position.
+    uint16_t count[4]; //!< Number of primitives of a leaf child, zero for inner children.
+};
+
+/// @brief Bounding volume hierarchy with four children per node.
+/// It is collapsed from a binary bvh_tree, so it indexes primitives the same way:
+/// leaves cover contiguous runs of positions in prim_indices.
+class bvh4_tree {
+    public:
+        std::vector<bvh4_node> nodes; //!< Nodes, the root first.
+        std::vector<uint32_t> prim_indices; //!< Original index of the primitive at each position.
+
+        /// @brief Build the hierarchy over a set of boxes.
+        /// @param boxes Box of each primitive.
+        void build(const std::vector<aabb>& boxes) {
+            bvh_tree binary;
+            binary.build(boxes);
+            prim_indices = binary.prim_indices;
+            nodes.clear();
+            if(binary.nodes.empty()) return;
+
+            nodes.reserve(binary.nodes.size() / 2 + 1);
+            collapse(binary, 0);
+        }
+
+        /// @brief Walk the nodes hit by a ray and hand every primitive of the leaves to a callback.
+        /// Hit children are visited nearest first, and entries farther than the closest hit
+        /// found so far are skipped when they come off the stack.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @param hit_prim Callback bool(uint32_t position, interval& ray_t) that tests the primitive
+        /// at a position and, when it is hit, lowers ray_t.max to the hit distance.
+        /// @return True if the callback reported some hit.
+        /// @tparam any_hit Return at the first hit reported, for occlusion queries.
+        template <bool any_hit = false, class F>
+        bool traverse(const ray& r, interval ray_t, F&& hit_prim) const {
+            if(nodes.empty()) return false;
+
+            const point3& orig = r.origin();
+            const vec3& inv_d = r.inv_direction();
+            // Box minimums are measured from the origin rounded up and maximums from the origin
+            // rounded down, like in bvh_tree::hit_node, so the rounding only widens the slabs.
+            float o_near[3], o_far[3], inv[3];
+            int near_side[3];
+            for(int a = 0; a < 3; a++) {
+                inv[a] = float(inv_d[a]);
+                near_side[a] = inv_d[a] < 0;
+                o_near[a] = near_side[a] ? round_down(orig[a]) : round_up(orig[a]);
+                o_far[a] = near_side[a] ? round_up(orig[a]) : round_down(orig[a]);
+            }
+
+            struct entry {
+                uint32_t child;
+                uint32_t count;
+                float t_near;
+            };
+            entry stack[stack_size];
+            int top = 0;
+            stack[top++] = {0, 0, round_down(ray_t.min)};
+            bool hit_anything = false;
+
+            while(top > 0) {
+                entry e = stack[--top];
+                if(e.t_near > round_up(ray_t.max) * slack) continue;
+
+                if(e.count > 0) {
+                    for(uint32_t p = e.child; p < e.child + e.count; p++) {
+                        BVH_COUNT(primitives_tested);
+                        if(hit_prim(p, ray_t)) {
+                            if(any_hit) return true;
+                            hit_anything = true;
+                        }
+                    }
+                    continue;
+                }
+
+                const bvh4_node& node = nodes[e.child];
+                BVH_COUNT(nodes_visited);
+
+                float t_near[4];
+                int mask = hit_children(node, o_near, o_far, inv, near_side, round_down(ray_t.min), round_up(ray_t.max), t_near);
+                if(mask == 0) continue;
+
+                // Push the hit children farthest first, so the nearest is popped next.
+                int order[4], n = 0;
+                for(int c = 0; c < 4; c++) {
+                    if(!(mask & (1 << c))) continue;
+                    int k = n++;
+                    while(k > 0 && t_near[order[k - 1]] < t_near[c]) {
+                        order[k] = order[k - 1];
+                        k--;
+                    }
+                    order[k] = c;
+                }
+                for(int k = 0; k < n; k++) {
+                    int c = order[k];
+                    stack[top++] = {node.child[c], node.count[c], t_near[c]};
+                }
+            }
+
+            return hit_anything;
+        }
+
+        /// @brief Get the memory used by the nodes and the primitive indices.
+        /// @return Size in bytes.
+        size_t memory_bytes() const {
+            return nodes.size() * sizeof(bvh4_node) + prim_indices.size() * sizeof(uint32_t);
+        }
+
+    private:
+        // At most three entries stay on the stack per level, and the binary tree is at most 64 deep.
+        static const int stack_size = 256;
+        // Same allowance for single precision rounding as the binary tree's box test.
+        static constexpr float slack = 1.0000004f;
+
+        /// @brief Turn a binary node and the nodes under it into 4-wide nodes.
+        /// The children are gathered by opening the largest inner node until there are four.
+        /// @param binary Binary tree.
+        /// @param root Binary node, an inner one unless it is the root of a single leaf tree.
+        /// @return Index of the wide node.
+        uint32_t collapse(const bvh_tree& binary, uint32_t root) {
+            uint32_t index = uint32_t(nodes.size());
+            nodes.emplace_back();
+
+            uint32_t children[4];
+            int n = 0;
+            if(binary.nodes[root].count > 0) {
+                children[n++] = root;
+            } else {
+                children[n++] = root + 1;
+                children[n++] = binary.nodes[root].offset;
+            }
+
+            while(n < 4) {
+                int widest = -1;
+                double widest_area = -1;
+                for(int c = 0; c < n; c++) {
+                    const flat_bvh_node& child = binary.nodes[children[c]];
+                    if(child.count > 0) continue;
+                    double area = box_area(child);
+                    if(area > widest_area) {
+                        widest_area = area;
+                        widest = c;
+                    }
+                }
+                if(widest < 0) break;
+
+                uint32_t opened = children[widest];
+                children[widest] = opened + 1;
+                children[n++] = binary.nodes[opened].offset;
+            }
+
+            for(int c = 0; c < 4; c++) {
+                bvh4_node& node = nodes[index];
+                if(c >= n) {
+                    for(int a = 0; a < 3; a++) {
+                        node.lo[a][c] = std::numeric_limits<float>::infinity();
+                        node.hi[a][c] = -std::numeric_limits<float>::infinity();
+                    }
+                    node.child[c] = 0;
+                    node.count[c] = 0;
+                    continue;
+                }
+
+                const flat_bvh_node& child = binary.nodes[children[c]];
+                for(int a = 0; a < 3; a++) {
+                    node.lo[a][c] = child.lo[a];
+                    node.hi[a][c] = child.hi[a];
+                }
+                node.count[c] = child.count;
+                node.child[c] = child.offset;
+            }
+
+            // Inner children are collapsed after the node is filled, since that grows the node list.
+            for(int c = 0; c < n; c++) {
+                if(binary.nodes[children[c]].count > 0) continue;
+                uint32_t child = collapse(binary, children[c]);
+                nodes[index].child[c] = child;
+            }
+            return index;
+        }
+
+        static double box_area(const flat_bvh_node& node) {
+            double dx = node.hi[0] - node.lo[0], dy = node.hi[1] - node.lo[1], dz = node.hi[2] - node.lo[2];
+            return dx * dy + dy * dz + dz * dx;
+        }
+
+        /// @brief Test a ray against the four child boxes of a node at once.
+        /// The near and far planes of each axis are picked by the sign of the direction,
+        /// so no min/max is needed per axis and empty boxes always miss.
+        /// @param node Node.
+        /// @param o_near Ray origin, rounded for the near planes.
+        /// @param o_far Ray origin, rounded for the far planes.
+        /// @param inv Inverse of the ray direction.
+        /// @param near_side 1 on the axes where the ray enters through the box maximum.
+        /// @param t_min Start of the ray interval.
+        /// @param t_max End of the ray interval.
+        /// @param t_near Entry distance of each child.
+        /// @return Bit mask of the children hit.
+        static int hit_children(const bvh4_node& node, const float o_near[3], const float o_far[3], const float inv[3],
+                                const int near_side[3], float t_min, float t_max, float t_near[4]) {
+#ifdef WIDE_BVH_SSE
+            __m128 enter = _mm_set1_ps(t_min);
+            __m128 exit = _mm_set1_ps(t_max);
+            for(int a = 0; a < 3; a++) {
+                const float* near_plane = near_side[a] ? node.hi[a] : node.lo[a];
+                const float* far_plane = near_side[a] ? node.lo[a] : node.hi[a];
+                __m128 inverse = _mm_set1_ps(inv[a]);
+                enter = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(near_plane), _mm_set1_ps(o_near[a])), inverse), enter);
+                exit = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(far_plane), _mm_set1_ps(o_far[a])), inverse), exit);
+            }
+            _mm_storeu_ps(t_near, enter);
+            return _mm_movemask_ps(_mm_cmple_ps(enter, _mm_mul_ps(exit, _mm_set1_ps(slack))));
+#else
+            int mask = 0;
+            for(int c = 0; c < 4; c++) {
+                float enter = t_min, exit = t_max;
+                for(int a = 0; a < 3; a++) {
+                    float t0 = ((near_side[a] ? node.hi[a][c] : node.lo[a][c]) - o_near[a]) * inv[a];
+                    float t1 = ((near_side[a] ? node.lo[a][c] : node.hi[a][c]) - o_far[a]) * inv[a];
+                    enter = t0 > enter ? t0 : enter;
+                    exit = t1 < exit ? t1 : exit;
+                }
+                t_near[c] = enter;
+                if(enter <= exit * slack) mask |= 1 << c;
+            }
+            return mask;
+#endif
+        }
+};
+
+/// @brief Hittable over a 4-wide bounding volume hierarchy.
+/// The objects are stored in the order of the tree's leaves, like in flat_bvh.
+class wide_bvh : public hittable {
+    public:
+        /// @brief Constructor for a hierarchy over all objects of a list.
+        /// @param list List of objects.
+        wide_bvh(const hittable_list& list) : wide_bvh(list.get_objects()) {}
+
+        /// @brief Constructor for a hierarchy over a set of objects.
+        /// @param objects Objects.
+        wide_bvh(const std::vector<shared_ptr<hittable>>& objects) {
+            std::vector<aabb> boxes;
+            boxes.reserve(objects.size());
+            for(const auto& object : objects) {
+                boxes.push_back(object->bounding_box());
+                bbox = aabb(bbox, boxes.back());
+            }
+
+            tree.build(boxes);
+
+            prims.reserve(objects.size());
+            for(uint32_t index : tree.prim_indices)
+                prims.push_back(objects[index]);
+        }
+
+        /// @brief Finds the closest object of the hierarchy hit by a ray.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @param rec Hit record.
+        /// @return True if the ray hits some object.
+        bool intersect(const ray& r, interval ray_t, hit_record& rec) const override {
+            return tree.traverse(r, ray_t, [&](uint32_t p, interval& t) {
+                if(!intersect_child(*prims[p], r, t, rec)) return false;
+                t.max = rec.t;
+                return true;
+            });
+        }
+
+        /// @brief Decides if any object of the hierarchy blocks a ray, stopping at the first one found.
+        /// @param r Ray.
+        /// @param ray_t Valid ray interval.
+        /// @return True if the ray hits some object.
+        bool occluded(const ray& r, interval ray_t) const override {
+            return tree.traverse<true>(r, ray_t, [&](uint32_t p, interval& t) {
+                return prims[p]->occluded(r, t);
+            });
+        }
+
+        /// @brief Get the hierarchy's bounding box.
+        /// @return Box that encloses all objects.
+        aabb bounding_box() const override { return bbox; }
+
+        /// @brief Get the hierarchy's tree.
+        /// @return Tree.
+        const bvh4_tree& get_tree() const { return tree; }
+
+    private:
+        bvh4_tree tree;
+        std::vector<shared_ptr<hittable>> prims; // Objects in leaf order.
+        aabb bbox;
+};
+
+#endif
@@ -0,0 +1,1255 @@
+/*!
+ * \file Benchmarks for the ray tracer's acceleration structures.
+ * Run from the build directory, like main: `./bench [section...]` (no section runs all).
+ */
+
+#include "../include/obj.hpp"
+#include "../include/sphere.hpp"
+#include "../include/hittable_list.hpp"
+#include "../include/bvh.hpp"
+#include "../include/flat_bvh.hpp"
+#include "../include/wide_bvh.hpp"
+#include "../include/instance.hpp"
+#include "../include/quantized_bvh.hpp"
+#include "../include/triangle_mesh.hpp"
+#include "../include/sbvh.hpp"
+#include "../include/scene.hpp"
+#include "../include/material.hpp"
+#include "../include/camera.hpp"
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <cstdio>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+// Scanned model of Atividade04, read from there instead of keeping a copy in this project.
+const string cat_path = "../../Atividade04/input/cat.obj";
+
+/// @brief Get the bytes currently allocated on the heap, to measure what a structure costs.
+/// @return Allocated bytes, 0 where glibc's allocator statistics are not available.
+size_t heap_bytes() {
+#ifdef __GLIBC__
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+/// @brief Hardware counter of read misses in one cache level for the calling thread.
+/// Uses perf_event_open, so it is only available on Linux and when the kernel lets
+/// unprivileged processes read counters (see /proc/sys/kernel/perf_event_paranoid).
+class cache_miss_counter {
+    public:
+        /// @brief Constructor.
+        /// @param cache Cache level, PERF_COUNT_HW_CACHE_L1D or PERF_COUNT_HW_CACHE_LL.
+        cache_miss_counter(int cache) {
+#ifdef __linux__
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+        }
+
+        ~cache_miss_counter() {
+#ifdef __linux__
+            if(fd >= 0) close(fd);
+#endif
+        }
+
+        /// @brief Decide if the counter could be opened.
+        /// @return True if it counts.
+        bool valid() const { return fd >= 0; }
+
+        /// @brief Count the misses of a piece of code.
+        /// @param work Code to measure.
+        /// @return Number of misses, -1 if the counter is not valid.
+        long long measure(const function<void()>& work) {
+            long long misses = -1;
+#ifdef __linux__
+            if(fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+                work();
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+                if(read(fd, &misses, sizeof(misses)) != sizeof(misses)) misses = -1;
+            }
+#endif
+            return misses;
+        }
+
+    private:
+        int fd = -1;
+};
+
+/// @brief Build a closed triangle mesh of a sphere, split in stacks and slices.
+/// @param stacks Number of horizontal bands.
+/// @param slices Number of vertical bands.
+/// @param mat Material of the triangles.
+/// @return Triangles, 2 * stacks * slices of them.
+vector<shared_ptr<hittable>> sphere_mesh(int stacks, int slices, const material* mat) {
+    auto vertex_at = [&](int i, int j) {
+        double theta = pi * i / stacks;
+        double phi = 2 * pi * j / slices;
+        point3 p(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+        vertex v(p);
+        v.normal = p;
+        return v;
+    };
+
+    vector<shared_ptr<hittable>> triangles;
+    for(int i = 0; i < stacks; i++) {
+        for(int j = 0; j < slices; j++) {
+            vertex a = vertex_at(i, j), b = vertex_at(i + 1, j);
+            vertex c = vertex_at(i + 1, j + 1), d = vertex_at(i, j + 1);
+            triangles.push_back(make_shared<triangle>(a, b, c, mat));
+            triangles.push_back(make_shared<triangle>(a, c, d, mat));
+        }
+    }
+    return triangles;
+}
+
+/// @brief Generate rays from points around a box towards points inside it.
+/// @param box Box to aim at.
+/// @param n Number of rays.
+/// @return Rays.
+vector<ray> random_rays(const aabb& box, int n) {
+    pcg32 rng(42, 7);
+    point3 c = box.center();
+    double radius = 0.5 * vec3(box.x.size(), box.y.size(), box.z.size()).length();
+
+    vector<ray> rays;
+    for(int i = 0; i < n; i++) {
+        double u = rng.next_double(), v = rng.next_double();
+        double theta = acos(1 - 2 * u), phi = 2 * pi * v;
+        point3 origin = c + 3 * radius * vec3(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+        point3 target = c + 0.5 * radius * vec3(rng.next_double() - 0.5, rng.next_double() - 0.5, rng.next_double() - 0.5);
+        rays.push_back(ray(origin, target - origin));
+    }
+    return rays;
+}
+
+/// @brief Measure closest-hit queries per second of a hittable.
+/// @param world Hittable to query.
+/// @param rays Rays.
+/// @param hits Number of rays that hit something.
+/// @return Millions of rays per second.
+double mrays_per_second(const hittable& world, const vector<ray>& rays, int& hits) {
+    hit_record rec;
+    hits = 0;
+    auto start = chrono::steady_clock::now();
+    for(const ray& r : rays)
+        hits += world.hit(r, interval(0.001, infinity), rec);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    return rays.size() / elapsed.count() / 1e6;
+}
+
+/// @brief Build a small world of spheres with the three materials of main, for render benchmarks.
+/// @param materials Table that owns the materials.
+/// @return World.
+scene render_world(material_table& materials) {
+    scene world;
+    world.add(sphere(point3(0, -101, -1), 100, materials.add<lambertian>(color(0.8, 0.8, 0.0))));
+    world.add(sphere(point3(0, 0, -1), 0.5, materials.add<lambertian>(color(0.1, 0.2, 0.5))));
+    world.add(sphere(point3(-1, 0, -1), 0.5, materials.add<dielectric>(1.5)));
+    world.add(sphere(point3(1, 0, -1), 0.5, materials.add<metal>(color(0.8, 0.6, 0.2), 0.3)));
+    world.build();
+    return world;
+}
+
+/// @brief Set up a small camera looking at render_world.
+/// @param samples Samples per pixel.
+/// @param seed Base seed of the random streams.
+/// @return Camera.
+camera render_camera(int samples, uint64_t seed) {
+    camera cam;
+    cam.img_width = 160;
+    cam.samples_per_pixel = samples;
+    cam.max_depth = 10;
+    cam.look_from = point3(0, 0.5, 1);
+    cam.look_at = point3(0, 0, -1);
+    cam.seed = seed;
+    cam.path = "bench_render.png";
+    cam.film_path = "bench_render.film";
+    return cam;
+}
+
+/// @brief Render a world and read back the linear samples. The scratch image and film are removed.
+/// @param cam Camera, saving its film to film_path.
+/// @param world World.
+/// @param seconds Render time.
+/// @return Film.
+film render_film(camera cam, const hittable& world, double& seconds) {
+    auto start = chrono::steady_clock::now();
+    cam.render(world);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    seconds = elapsed.count();
+
+    film result;
+    uint64_t seed;
+    result.read(cam.film_path, seed);
+    std::remove(cam.path.c_str());
+    std::remove(cam.film_path.c_str());
+    return result;
+}
+
+/// @brief Get the root mean square difference of two films' pixels, in gamma 2 luminance.
+/// @param a Film.
+/// @param reference Film of the same frame.
+/// @return Error.
+double gamma_rmse(const film& a, const film& reference) {
+    double sum = 0;
+    for(size_t i = 0; i < a.samples.size(); i++) {
+        double d = sqrt(film::luminance(a.mean(i))) - sqrt(film::luminance(reference.mean(i)));
+        sum += d * d;
+    }
+    return sqrt(sum / a.samples.size());
+}
+
+/// @brief Compare the linear list against the SAH BVH on meshes of increasing size.
+void bench_bvh() {
+    material_table materials;
+    const material* mat = materials.add<lambertian>(color(0.5, 0.5, 0.5));
+    vector<pair<string, vector<shared_ptr<hittable>>>> meshes;
+
+    for(int n : {5, 10, 20, 40, 80})
+        meshes.push_back({"sphere " + to_string(2 * n * 2 * n), sphere_mesh(n, 2 * n, mat)});
+
+    obj cat(cat_path, mat);
+    vector<shared_ptr<hittable>> cat_triangles;
+    for(triangle t : cat.get_triangle_faces())
+        cat_triangles.push_back(make_shared<triangle>(t));
+    meshes.push_back({"cat.obj " + to_string(cat_triangles.size()), cat_triangles});
+
+    cout << "\n== Linear list vs SAH BVH (closest hit, Mrays/s) ==\n";
+    cout << left << setw(20) << "mesh" << setw(12) << "list" << setw(12) << "bvh"
+         << setw(12) << "build ms" << "speedup\n";
+
+    for(auto& [name, triangles] : meshes) {
+        hittable_list list;
+        for(auto& t : triangles) list.add(t);
+
+        auto start = chrono::steady_clock::now();
+        bvh_node bvh(list);
+        chrono::duration<double, milli> build = chrono::steady_clock::now() - start;
+
+        vector<ray> rays = random_rays(list.bounding_box(), 20000);
+        int list_hits, bvh_hits;
+        double list_speed = mrays_per_second(list, rays, list_hits);
+        double bvh_speed = mrays_per_second(bvh, rays, bvh_hits);
+
+        cout << setw(20) << name << setw(12) << list_speed << setw(12) << bvh_speed
+             << setw(12) << build.count() << bvh_speed / list_speed << "x"
+             << (list_hits != bvh_hits ? "  (hit count mismatch!)" : "") << "\n";
+    }
+}
+
+/// @brief Compare the pointer-based BVH against the flattened one on the same scenes.
+/// Both are built over the same triangles and answer the same rays; traversal work
+/// is counted per ray and cache misses are read from the hardware when possible.
+void bench_layout() {
+    material_table materials;
+    const material* mat = materials.add<lambertian>(color(0.5, 0.5, 0.5));
+    vector<pair<string, vector<shared_ptr<hittable>>>> meshes;
+    meshes.push_back({"sphere 25600", sphere_mesh(80, 160, mat)});
+
+    obj cat(cat_path, mat);
+    vector<shared_ptr<hittable>> cat_triangles;
+    for(triangle t : cat.get_triangle_faces())
+        cat_triangles.push_back(make_shared<triangle>(t));
+    meshes.push_back({"cat.obj " + to_string(cat_triangles.size()), cat_triangles});
+
+    cache_miss_counter l1(PERF_COUNT_HW_CACHE_L1D), llc(PERF_COUNT_HW_CACHE_LL);
+    if(!l1.valid() || !llc.valid())
+        cout << "\n(cache counters unavailable, run `perf stat -e L1-dcache-load-misses,LLC-load-misses ./bench layout` instead)\n";
+
+    cout << "\n== Pointer BVH vs flattened BVH (closest hit) ==\n";
+    cout << left << setw(20) << "mesh" << setw(10) << "layout" << setw(10) << "Mrays/s" << setw(12) << "nodes/ray"
+         << setw(14) << "L1D miss/ray" << setw(14) << "LLC miss/ray" << "memory KiB\n";
+
+    for(auto& [name, triangles] : meshes) {
+        bvh_node pointer_bvh(triangles);
+        flat_bvh flat(triangles);
+        vector<ray> rays = random_rays(pointer_bvh.bounding_box(), 200000);
+
+        // A pointer node holds two shared pointers and a box, its children are allocated one by one.
+        size_t pointer_bytes = (triangles.size() - 1) * (sizeof(bvh_node) + 2 * sizeof(void*));
+        size_t flat_bytes = flat.get_tree().memory_bytes();
+
+        int hits[2];
+        const hittable* layouts[2] = {&pointer_bvh, &flat};
+        const char* labels[2] = {"pointer", "flat"};
+        for(int k = 0; k < 2; k++) {
+            thread_traversal_stats() = traversal_stats();
+            double speed = mrays_per_second(*layouts[k], rays, hits[k]);
+            double nodes = double(thread_traversal_stats().nodes_visited) / rays.size();
+
+            auto trace = [&]() { int h; mrays_per_second(*layouts[k], rays, h); };
+            long long l1_misses = l1.measure(trace), llc_misses = llc.measure(trace);
+
+            cout << setw(20) << name << setw(10) << labels[k] << setw(10) << speed << setw(12) << nodes;
+            if(l1_misses >= 0) cout << setw(14) << double(l1_misses) / rays.size();
+            else cout << setw(14) << "n/a";
+            if(llc_misses >= 0) cout << setw(14) << double(llc_misses) / rays.size();
+            else cout << setw(14) << "n/a";
+            cout << (k == 0 ? pointer_bytes : flat_bytes) / 1024 << "\n";
+        }
+        if(hits[0] != hits[1]) cout << "(hit count mismatch!)\n";
+    }
+}
+
+/// @brief Get the boxes of the triangles of a sphere mesh without building the triangles.
+/// @param stacks Number of horizontal bands.
+/// @param slices Number of vertical bands.
+/// @return Boxes, 2 * stacks * slices of them.
+vector<aabb> sphere_mesh_boxes(int stacks, int slices) {
+    auto vertex_at = [&](int i, int j) {
+        double theta = pi * i / stacks;
+        double phi = 2 * pi * j / slices;
+        return point3(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+    };
+
+    vector<aabb> boxes;
+    boxes.reserve(size_t(2) * stacks * slices);
+    for(int i = 0; i < stacks; i++) {
+        for(int j = 0; j < slices; j++) {
+            point3 a = vertex_at(i, j), b = vertex_at(i + 1, j);
+            point3 c = vertex_at(i + 1, j + 1), d = vertex_at(i, j + 1);
+            boxes.push_back(aabb(aabb(a, b), aabb(c, c)).pad());
+            boxes.push_back(aabb(aabb(a, c), aabb(d, d)).pad());
+        }
+    }
+    return boxes;
+}
+
+/// @brief Measure the binned SAH build on meshes from 10k to 10M triangles, on one thread and on all of them.
+void bench_build() {
+    int threads = max(1, int(thread::hardware_concurrency()));
+
+    cout << "\n== Binned SAH build (" << threads << " hardware threads) ==\n";
+    cout << left << setw(12) << "triangles" << setw(14) << "1 thread ms" << setw(14) << "all ms"
+         << setw(10) << "scaling" << setw(12) << "Mtris/s" << setw(12) << "nodes" << "SAH cost\n";
+
+    for(int n : {10000, 100000, 1000000, 10000000}) {
+        int stacks = max(1, int(sqrt(n / 4.0)));
+        vector<aabb> boxes = sphere_mesh_boxes(stacks, n / (2 * stacks));
+
+        double ms[2];
+        bvh_tree tree;
+        int thread_counts[2] = {1, threads};
+        for(int k = 0; k < 2; k++) {
+            auto start = chrono::steady_clock::now();
+            tree.build(boxes, thread_counts[k]);
+            chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+            ms[k] = elapsed.count();
+        }
+
+        cout << setw(12) << boxes.size() << setw(14) << ms[0] << setw(14) << ms[1] << setw(10) << ms[0] / ms[1]
+             << setw(12) << boxes.size() / ms[1] / 1e3 << setw(12) << tree.nodes.size() << tree.sah_cost() << "\n";
+    }
+}
+
+/// @brief Measure a two-level hierarchy over growing numbers of instances of one mesh.
+/// The mesh's hierarchy is built once; each instance adds a transform pair and a top-level leaf.
+void bench_instances() {
+    material_table materials;
+    const material* mat = materials.add<lambertian>(color(0.5, 0.5, 0.5));
+    obj cat(cat_path, mat);
+    vector<shared_ptr<hittable>> triangles;
+    for(triangle t : cat.get_triangle_faces())
+        triangles.push_back(make_shared<triangle>(t));
+
+    auto start = chrono::steady_clock::now();
+    auto mesh = make_shared<flat_bvh>(triangles);
+    chrono::duration<double, milli> mesh_build = chrono::steady_clock::now() - start;
+
+    size_t mesh_bytes = mesh->get_tree().memory_bytes() + triangles.size() * (sizeof(triangle) + 2 * sizeof(void*));
+    aabb box = mesh->bounding_box();
+    double spacing = 1.5 * max(box.x.size(), max(box.y.size(), box.z.size()));
+
+    cout << "\n== Instances of cat.obj (" << triangles.size() << " triangles, mesh built once in "
+         << mesh_build.count() << " ms, " << mesh_bytes / 1024 << " KiB) ==\n";
+    cout << left << setw(11) << "instances" << setw(14) << "scene KiB" << setw(16) << "flattened KiB"
+         << setw(12) << "top ms" << setw(12) << "move ms" << "Mrays/s\n";
+
+    for(int n : {1, 10, 100, 1000}) {
+        int side = int(ceil(cbrt(double(n))));
+        vector<shared_ptr<hittable>> instances;
+        for(int i = 0; i < n; i++) {
+            vec3 offset(spacing * (i % side), spacing * ((i / side) % side), spacing * (i / (side * side)));
+            instances.push_back(make_shared<instance>(mesh, translate(offset) * rotate_y(37.0 * i)));
+        }
+
+        start = chrono::steady_clock::now();
+        flat_bvh top(instances);
+        chrono::duration<double, milli> top_build = chrono::steady_clock::now() - start;
+
+        // Move one instance: only the top level is rebuilt, the mesh is not touched.
+        start = chrono::steady_clock::now();
+        auto moved = static_pointer_cast<instance>(instances[0]);
+        moved->set_transform(translate(vec3(-spacing, 0, 0)) * moved->get_transform());
+        top.rebuild();
+        chrono::duration<double, milli> move = chrono::steady_clock::now() - start;
+
+        size_t scene_bytes = mesh_bytes + n * (sizeof(instance) + 2 * sizeof(void*)) + top.get_tree().memory_bytes();
+        size_t flattened_bytes = n * mesh_bytes;
+
+        vector<ray> rays = random_rays(top.bounding_box(), 20000);
+        int hits;
+        double speed = mrays_per_second(top, rays, hits);
+
+        cout << setw(11) << n << setw(14) << scene_bytes / 1024 << setw(16) << flattened_bytes / 1024
+             << setw(12) << top_build.count() << setw(12) << move.count() << speed << "\n";
+    }
+}
+
+/// @brief Animate a scene for some frames, preparing its hierarchy with update (refit) every frame.
+/// Compares against building a fresh hierarchy every frame.
+/// @param name Scene name.
+/// @param objects Objects of the scene.
+/// @param animate Moves the objects to a frame.
+/// @param frames Number of frames.
+void run_animation(const string& name, const vector<shared_ptr<hittable>>& objects,
+                   const function<void(int)>& animate, int frames) {
+    flat_bvh bvh(objects);
+    double update_ms = 0, build_ms = 0;
+    int rebuilds = 0;
+
+    for(int frame = 1; frame <= frames; frame++) {
+        animate(frame);
+
+        auto start = chrono::steady_clock::now();
+        rebuilds += bvh.update();
+        chrono::duration<double, milli> update = chrono::steady_clock::now() - start;
+        update_ms += update.count();
+
+        start = chrono::steady_clock::now();
+        flat_bvh fresh(objects);
+        chrono::duration<double, milli> build = chrono::steady_clock::now() - start;
+        build_ms += build.count();
+    }
+
+    flat_bvh fresh(objects);
+    vector<ray> rays = random_rays(fresh.bounding_box(), 20000);
+    int hits[2];
+    double refit_speed = mrays_per_second(bvh, rays, hits[0]);
+    double fresh_speed = mrays_per_second(fresh, rays, hits[1]);
+
+    cout << setw(24) << name << setw(12) << update_ms / frames << setw(12) << build_ms / frames
+         << setw(10) << rebuilds << setw(12) << bvh.get_tree().sah_cost() / fresh.get_tree().sah_cost()
+         << setw(12) << refit_speed << fresh_speed
+         << (hits[0] != hits[1] ? "  (hit count mismatch!)" : "") << "\n";
+}
+
+/// @brief Measure per-frame preparation of animated scenes: refit with quality-triggered rebuilds vs full builds.
+void bench_refit() {
+    material_table materials;
+    const material* mat = materials.add<lambertian>(color(0.5, 0.5, 0.5));
+    int frames = 30;
+
+    cout << "\n== Refit vs rebuild per frame (" << frames << " frames) ==\n";
+    cout << left << setw(24) << "scene" << setw(12) << "update ms" << setw(12) << "build ms"
+         << setw(10) << "rebuilds" << setw(12) << "cost ratio" << setw(12) << "refit Mr/s" << "fresh Mr/s\n";
+
+    // A sphere mesh that ripples: small vertex motion, the tree keeps its quality.
+    vector<shared_ptr<hittable>> mesh = sphere_mesh(80, 160, mat);
+    vector<array<vertex, 3>> rest;
+    for(auto& object : mesh) {
+        auto t = static_pointer_cast<triangle>(object);
+        rest.push_back({t->A, t->B, t->C});
+    }
+    auto ripple = [&](int frame) {
+        auto move = [frame](vertex v) {
+            v.coord = v.coord * (1 + 0.05 * sin(8 * v.coord.y() + 0.3 * frame));
+            return v;
+        };
+        for(size_t i = 0; i < mesh.size(); i++)
+            static_pointer_cast<triangle>(mesh[i])->set_vertices(move(rest[i][0]), move(rest[i][1]), move(rest[i][2]));
+    };
+    run_animation("rippling mesh 25600", mesh, ripple, frames);
+
+    // Spheres drifting apart in random directions: the tree degrades until a rebuild.
+    pcg32 rng(7, 3);
+    vector<shared_ptr<hittable>> spheres;
+    vector<vec3> velocity;
+    for(int i = 0; i < 20000; i++) {
+        point3 center(rng.next_double() * 100, rng.next_double() * 100, rng.next_double() * 100);
+        spheres.push_back(make_shared<sphere>(center, 0.5, mat));
+        velocity.push_back(vec3(rng.next_double() - 0.5, rng.next_double() - 0.5, rng.next_double() - 0.5));
+    }
+    auto drift = [&](int) {
+        for(size_t i = 0; i < spheres.size(); i++) {
+            auto s = static_pointer_cast<sphere>(spheres[i]);
+            s->set_center(s->get_center() + velocity[i]);
+        }
+    };
+    run_animation("drifting spheres 20000", spheres, drift, frames);
+
+    // The same drift on a scene, which stores the spheres by value.
+    scene drifting;
+    for(int i = 0; i < 20000; i++) {
+        point3 center(rng.next_double() * 100, rng.next_double() * 100, rng.next_double() * 100);
+        drifting.add(sphere(center, 0.5, mat));
+    }
+    drifting.build();
+    double update_ms = 0;
+    int rebuilds = 0;
+    for(int frame = 1; frame <= frames; frame++) {
+        for(size_t i = 0; i < velocity.size(); i++) {
+            sphere& s = drifting.get_sphere(i);
+            s.set_center(s.get_center() + velocity[i]);
+        }
+        auto start = chrono::steady_clock::now();
+        rebuilds += drifting.update();
+        chrono::duration<double, milli> update = chrono::steady_clock::now() - start;
+        update_ms += update.count();
+    }
+    scene fresh = drifting;
+    fresh.build();
+    vector<ray> rays = random_rays(fresh.bounding_box(), 20000);
+    int hits[2];
+    double refit_speed = mrays_per_second(drifting, rays, hits[0]);
+    double fresh_speed = mrays_per_second(fresh, rays, hits[1]);
+    cout << setw(24) << "drifting scene 20000" << setw(12) << update_ms / frames << setw(12) << "-"
+         << setw(10) << rebuilds << setw(12) << "-" << setw(12) << refit_speed << fresh_speed
+         << (hits[0] != hits[1] ? "  (hit count mismatch!)" : "") << "\n";
+}
+
+/// @brief Compare the linear list, the binary flat BVH and the 4-wide BVH on the same scenes.
+void bench_wide() {
+    material_table materials;
+    const material* mat = materials.add<lambertian>(color(0.5, 0.5, 0.5));
+    vector<pair<string, vector<shared_ptr<hittable>>>> scenes;
+    scenes.push_back({"sphere 25600", sphere_mesh(80, 160, mat)});
+
+    obj cat(cat_path, mat);
+    vector<shared_ptr<hittable>> cat_triangles;
+    for(triangle t : cat.get_triangle_faces())
+        cat_triangles.push_back(make_shared<triangle>(t));
+    scenes.push_back({"cat.obj " + to_string(cat_triangles.size()), cat_triangles});
+
+    // Spheres and triangles mixed, like the world in main.
+    pcg32 rng(11, 5);
+    vector<shared_ptr<hittable>> mixed = sphere_mesh(20, 40, mat);
+    for(int i = 0; i < 2000; i++) {
+        point3 center(rng.next_double() * 8 - 4, rng.next_double() * 8 - 4, rng.next_double() * 8 - 4);
+        mixed.push_back(make_shared<sphere>(center, 0.05 + 0.1 * rng.next_double(), mat));
+    }
+    scenes.push_back({"mixed " + to_string(mixed.size()), mixed});
+
+    cout << "\n== Linear list vs binary vs 4-wide BVH (closest hit) ==\n";
+    cout << left << setw(16) << "scene" << setw(10) << "layout" << setw(10) << "Mrays/s" << setw(12) << "nodes/ray"
+         << setw(12) << "prims/ray" << "memory KiB\n";
+
+    for(auto& [name, objects] : scenes) {
+        hittable_list list;
+        for(auto& object : objects) list.add(object);
+        flat_bvh binary(objects);
+        wide_bvh wide(objects);
+        vector<ray> rays = random_rays(list.bounding_box(), 50000);
+
+        const hittable* layouts[3] = {&list, &binary, &wide};
+        const char* labels[3] = {"list", "binary", "4-wide"};
+        size_t bytes[3] = {0, binary.get_tree().memory_bytes(), wide.get_tree().memory_bytes()};
+        int hits[3];
+        for(int k = 0; k < 3; k++) {
+            // The list is too slow for the full ray set.
+            vector<ray> subset(rays.begin(), rays.begin() + (k == 0 ? 2000 : rays.size()));
+            thread_traversal_stats() = traversal_stats();
+            double speed = mrays_per_second(*layouts[k], subset, hits[k]);
+            traversal_stats stats = thread_traversal_stats();
+
+            cout << setw(16) << name << setw(10) << labels[k] << setw(10) << speed;
+            if(k == 0) cout << setw(12) << "-" << setw(12) << objects.size();
+            else cout << setw(12) << double(stats.nodes_visited) / subset.size()
+                      << setw(12) << double(stats.primitives_tested) / subset.size();
+            cout << bytes[k] / 1024 << "\n";
+        }
+        if(hits[1] != hits[2]) cout << "(hit count mismatch!)\n";
+    }
+}
+
+/// @brief Build long thin triangles laid diagonally across a cube, the worst case for object splits:
+/// their boxes are large and mostly empty, so the children of object splits overlap.
+/// @param n Number of triangles.
+/// @param mat Material of the triangles.
+/// @return Triangles.
+vector<triangle> diagonal_slivers(int n, const material* mat) {
+    pcg32 rng(3, 9);
+    vector<triangle> faces;
+    for(int i = 0; i < n; i++) {
+        point3 a(rng.next_double() * 2 - 1, rng.next_double() * 2 - 1, rng.next_double() * 2 - 1);
+        vec3 along = 0.5 * unit_vector(vec3(1, 1, 1) + 0.2 * vec3(rng.next_double(), rng.next_double(), rng.next_double()));
+        vec3 width = 0.005 * unit_vector(cross(along, vec3(0, 1, 0)));
+        faces.push_back(triangle(vertex(a), vertex(a + along), vertex(a + width), mat));
+    }
+    return faces;
+}
+
+/// @brief Measure closest-hit queries on scenes where rays pass through many surfaces, so that
+/// most of the hits found are replaced by a closer one before the query ends.
+void bench_deferred() {
+    material_table materials;
+    const material* mat = materials.add<lambertian>(color(0.5, 0.5, 0.5));
+    vector<pair<string, shared_ptr<hittable>>> scenes;
+
+    // Innermost first, so each shell a ray meets is closer than the one before.
+    auto shells = make_shared<hittable_list>();
+    for(int i = 0; i < 64; i++)
+        shells->add(make_shared<sphere>(point3(0, 0, 0), 0.5 + 0.5 * i / 64, mat));
+    scenes.push_back({"shells 64", shells});
+
+    pcg32 rng(8, 1);
+    vector<shared_ptr<hittable>> spheres;
+    for(int i = 0; i < 20000; i++) {
+        point3 center(rng.next_double() * 4 - 2, rng.next_double() * 4 - 2, rng.next_double() * 4 - 2);
+        spheres.push_back(make_shared<sphere>(center, 0.1 + 0.2 * rng.next_double(), mat));
+    }
+    scenes.push_back({"spheres 20000", make_shared<flat_bvh>(spheres)});
+
+    obj cat(cat_path, mat);
+    scenes.push_back({"cat.obj objects", make_shared<flat_bvh>(*cat.get_mesh())});
+    scenes.push_back({"cat.obj mesh", cat.get_triangle_mesh()});
+
+    cout << "\n== Closest hit with deferred surface attributes ==\n";
+    cout << left << setw(18) << "scene" << setw(10) << "Mrays/s" << "hit rate\n";
+    for(auto& [name, world] : scenes) {
+        vector<ray> rays = random_rays(world->bounding_box(), 100000);
+        int hits;
+        double speed = mrays_per_second(*world, rays, hits);
+        cout << setw(18) << name << setw(10) << speed << double(hits) / rays.size() << "\n";
+    }
+}
+
+/// @brief Compare a hierarchy over pointers to hittables, tested through virtual calls, against
+/// a scene that stores spheres and triangles by value and dispatches on their type.
+void bench_dispatch() {
+    material_table materials;
+    const material* mat = materials.add<lambertian>(color(0.5, 0.5, 0.5));
+    vector<pair<string, vector<shared_ptr<hittable>>>> scenes;
+
+    pcg32 rng(13, 2);
+    vector<shared_ptr<hittable>> spheres;
+    for(int i = 0; i < 20000; i++) {
+        point3 center(rng.next_double() * 4 - 2, rng.next_double() * 4 - 2, rng.next_double() * 4 - 2);
+        spheres.push_back(make_shared<sphere>(center, 0.02 + 0.05 * rng.next_double(), mat));
+    }
+    scenes.push_back({"spheres 20000", spheres});
+    scenes.push_back({"sphere 25600", sphere_mesh(80, 160, mat)});
+
+    obj cat(cat_path, mat);
+    scenes.push_back({"cat.obj", cat.get_mesh()->get_objects()});
+
+    vector<shared_ptr<hittable>> mixed = sphere_mesh(40, 80, mat);
+    mixed.insert(mixed.end(), spheres.begin(), spheres.begin() + 5000);
+    scenes.push_back({"mixed", mixed});
+
+    cout << "\n== Virtual vs type-tagged primitive dispatch ==\n";
+    cout << left << setw(16) << "scene" << setw(12) << "hit rate" << setw(18) << "pointers Mrays/s"
+         << setw(18) << "by value Mrays/s" << "speedup\n";
+
+    for(auto& [name, objects] : scenes) {
+        flat_bvh pointers(objects);
+        scene values;
+        for(const auto& object : objects) {
+            if(auto s = dynamic_cast<const sphere*>(object.get())) values.add(*s);
+            else if(auto t = dynamic_cast<const triangle*>(object.get())) values.add(*t);
+            else values.add(object);
+        }
+        values.build();
+
+        vector<ray> rays = random_rays(pointers.bounding_box(), 200000);
+        int hits[2];
+        double speed[2] = {mrays_per_second(pointers, rays, hits[0]), mrays_per_second(values, rays, hits[1])};
+
+        cout << setw(16) << name << setw(12) << double(hits[1]) / rays.size() << setw(18) << speed[0]
+             << setw(18) << speed[1] << speed[1] / speed[0] << "x" << (hits[0] != hits[1] ? "  (mismatch!)" : "") << "\n";
+    }
+}
+
+/// @brief Write the sphere grid of sphere_mesh as an OBJ file, with shared vertices and normals.
+/// @param path Path of the file.
+/// @param stacks Number of horizontal bands.
+/// @param slices Number of vertical bands.
+void write_sphere_obj(const string& path, int stacks, int slices) {
+    ofstream file(path);
+    for(int i = 0; i <= stacks; i++) {
+        for(int j = 0; j < slices; j++) {
+            double theta = pi * i / stacks, phi = 2 * pi * j / slices;
+            // obj's parser drops the last character of vertex lines, so they end with a space.
+            file << "v " << sin(theta) * cos(phi) << " " << cos(theta) << " " << sin(theta) * sin(phi) << " \n";
+        }
+    }
+    for(int i = 0; i <= stacks; i++) {
+        for(int j = 0; j < slices; j++) {
+            double theta = pi * i / stacks, phi = 2 * pi * j / slices;
+            file << "vn " << sin(theta) * cos(phi) << " " << cos(theta) << " " << sin(theta) * sin(phi) << "\n";
+        }
+    }
+    auto index = [slices](int i, int j) { return 1 + i * slices + j % slices; };
+    for(int i = 0; i < stacks; i++) {
+        for(int j = 0; j < slices; j++) {
+            int a = index(i, j), b = index(i + 1, j), c = index(i + 1, j + 1), d = index(i, j + 1);
+            file << "f " << a << "//" << a << " " << b << "//" << b << " " << c << "//" << c << "\n";
+            file << "f " << a << "//" << a << " " << c << "//" << c << " " << d << "//" << d << "\n";
+        }
+    }
+}
+
+/// @brief Compare one triangle object per face against the indexed triangle mesh on OBJ files.
+void bench_mesh() {
+    material_table materials;
+    const material* mat = materials.add<lambertian>(color(0.5, 0.5, 0.5));
+    const string generated = "bench_sphere.obj";
+    write_sphere_obj(generated, 500, 1000);
+
+    cout << "\n== Triangle objects vs indexed triangle mesh ==\n";
+    cout << left << setw(20) << "file" << setw(10) << "layout" << setw(10) << "load s" << setw(12) << "memory MiB"
+         << setw(12) << "bytes/tri" << "Mrays/s\n";
+
+    // Objects are parsed with obj and built into a flat_bvh, the mesh is loaded straight from the file.
+    // Load time covers parsing and building, memory is what the result keeps.
+    for(string path : {cat_path, generated}) {
+        string name = path.substr(path.find_last_of('/') + 1);
+
+        int hits[2];
+        for(int k = 0; k < 2; k++) {
+            size_t before = heap_bytes(), faces;
+            auto start = chrono::steady_clock::now();
+            shared_ptr<hittable> mesh;
+            if(k == 0) {
+                obj file(path, mat);
+                faces = file.f_vec.size();
+                mesh = make_shared<flat_bvh>(*file.get_mesh());
+            } else {
+                auto loaded = obj::load_triangle_mesh(path, mat);
+                faces = loaded->size();
+                mesh = loaded;
+            }
+            chrono::duration<double> load = chrono::steady_clock::now() - start;
+            size_t bytes = heap_bytes() - before;
+
+            vector<ray> rays = random_rays(mesh->bounding_box(), 50000);
+            double speed = mrays_per_second(*mesh, rays, hits[k]);
+
+            cout << setw(20) << name << setw(10) << (k == 0 ? "objects" : "mesh") << setw(10) << load.count()
+                 << setw(12) << bytes / 1048576.0 << setw(12) << double(bytes) / faces << speed << "\n";
+        }
+        if(hits[0] != hits[1]) cout << "(hit count mismatch!)\n";
+    }
+    remove(generated.c_str());
+}
+
+/// @brief Compare full precision node boxes against boxes quantized to 16 and 8 bits.
+void bench_quantized() {
+    material_table materials;
+    const material* mat = materials.add<lambertian>(color(0.5, 0.5, 0.5));
+    vector<pair<string, vector<shared_ptr<hittable>>>> scenes;
+    scenes.push_back({"sphere 25600", sphere_mesh(80, 160, mat)});
+
+    obj cat(cat_path, mat);
+    vector<shared_ptr<hittable>> cat_triangles;
+    for(triangle t : cat.get_triangle_faces())
+        cat_triangles.push_back(make_shared<triangle>(t));
+    scenes.push_back({"cat.obj " + to_string(cat_triangles.size()), cat_triangles});
+
+    // Large enough that the full precision nodes no longer fit in a typical L2.
+    scenes.push_back({"sphere 360000", sphere_mesh(300, 600, mat)});
+
+    cout << "\n== Full precision vs quantized node boxes (closest hit) ==\n";
+    cout << left << setw(16) << "scene" << setw(10) << "layout" << setw(8) << "node B" << setw(12) << "memory KiB"
+         << setw(10) << "SAH cost" << setw(12) << "nodes/ray" << setw(12) << "prims/ray" << "Mrays/s\n";
+
+    for(auto& [name, objects] : scenes) {
+        flat_bvh full(objects);
+        quantized_bvh<uint16_t> q16(objects);
+        quantized_bvh<uint8_t> q8(objects);
+        vector<ray> rays = random_rays(full.bounding_box(), 50000);
+
+        const hittable* layouts[3] = {&full, &q16, &q8};
+        const char* labels[3] = {"float", "16-bit", "8-bit"};
+        size_t node_bytes[3] = {sizeof(flat_bvh_node), sizeof(quantized_bvh_node<uint16_t>), sizeof(quantized_bvh_node<uint8_t>)};
+        size_t bytes[3] = {full.get_tree().memory_bytes(), q16.get_tree().memory_bytes(), q8.get_tree().memory_bytes()};
+        double costs[3] = {full.get_tree().sah_cost(), q16.get_tree().sah_cost(), q8.get_tree().sah_cost()};
+        int hits[3];
+        for(int k = 0; k < 3; k++) {
+            thread_traversal_stats() = traversal_stats();
+            double speed = mrays_per_second(*layouts[k], rays, hits[k]);
+            traversal_stats stats = thread_traversal_stats();
+
+            cout << setw(16) << name << setw(10) << labels[k] << setw(8) << node_bytes[k] << setw(12) << bytes[k] / 1024
+                 << setw(10) << costs[k] << setw(12) << double(stats.nodes_visited) / rays.size()
+                 << setw(12) << double(stats.primitives_tested) / rays.size() << speed << "\n";
+        }
+        if(hits[0] != hits[1] || hits[0] != hits[2]) cout << "(hit count mismatch!)\n";
+    }
+}
+
+/// @brief The plane-then-edges triangle test that triangle::intersect replaced, kept to compare against.
+/// @param A Corner A.
+/// @param B Corner B.
+/// @param C Corner C.
+/// @param normal Plane normal, cross(B - A, C - A).
+/// @param r Ray.
+/// @param ray_t Valid ray interval.
+/// @param t Distance of the intersection along the ray.
+/// @return True if the ray hits the triangle inside the interval.
+bool legacy_intersect(const point3& A, const point3& B, const point3& C, const vec3& normal,
+                      const ray& r, const interval& ray_t, double& t) {
+    double nd = dot(normal, r.direction());
+    if(fabs(nd) < 1e-8) return false;
+    t = (dot(normal, A) - dot(normal, r.origin())) / nd;
+    if(t < 0 || !ray_t.surrounds(t)) return false;
+
+    point3 P = r.at(t);
+    if(dot(normal, cross(B - A, P - A)) < 0) return false;
+    if(dot(normal, cross(C - B, P - B)) < 0) return false;
+    return dot(normal, cross(A - C, P - C)) >= 0;
+}
+
+/// @brief Compare the watertight kernel against the legacy plane-then-edges kernel:
+/// raw tests per second, traced rays per second, and rays lost through shared edges.
+void bench_triangle() {
+    // Closed sphere: corners are shared by index and the poles are single points,
+    // so every ray from the inside must hit some triangle.
+    const int stacks = 80, slices = 160;
+    vector<point3> points;
+    for(int i = 0; i <= stacks; i++) {
+        for(int j = 0; j < slices; j++) {
+            double theta = pi * i / stacks, phi = 2 * pi * j / slices;
+            double ring = (i == 0 || i == stacks) ? 0 : sin(theta);
+            points.push_back(point3(ring * cos(phi), cos(theta), ring * sin(phi)));
+        }
+    }
+    vector<array<point3, 3>> corners;
+    vector<vec3> normals;
+    vector<aabb> boxes;
+    auto add = [&](int a, int b, int c) {
+        vec3 normal = cross(points[b] - points[a], points[c] - points[a]);
+        if(normal.length_squared() == 0) return; // Collapsed at a pole.
+        corners.push_back({points[a], points[b], points[c]});
+        normals.push_back(normal);
+        boxes.push_back(aabb(aabb(points[a], points[b]), aabb(points[c], points[c])).pad());
+    };
+    for(int i = 0; i < stacks; i++) {
+        for(int j = 0; j < slices; j++) {
+            int a = i * slices + j, b = (i + 1) * slices + j;
+            int c = (i + 1) * slices + (j + 1) % slices, d = i * slices + (j + 1) % slices;
+            add(a, b, c);
+            add(a, c, d);
+        }
+    }
+    bvh_tree tree;
+    tree.build(boxes);
+
+    auto kernel = [&](int k, uint32_t f, const ray& r, const interval& ray_t, double& t) {
+        const array<point3, 3>& v = corners[f];
+        if(k == 0) return legacy_intersect(v[0], v[1], v[2], normals[f], r, ray_t, t);
+        double u, w;
+        return triangle::intersect(v[0], v[1], v[2], r, ray_t, t, u, w);
+    };
+
+    // Rays aimed at a random point of the parallelogram on each triangle's edges, half of them inside.
+    pcg32 rng(21, 4);
+    vector<pair<uint32_t, ray>> pairs;
+    for(int i = 0; i < 2000000; i++) {
+        uint32_t f = rng.next_uint() % corners.size();
+        const array<point3, 3>& v = corners[f];
+        point3 target = v[0] + rng.next_double() * (v[1] - v[0]) + rng.next_double() * (v[2] - v[0]);
+        point3 origin(rng.next_double() * 6 - 3, rng.next_double() * 6 - 3, rng.next_double() * 6 - 3);
+        pairs.push_back({f, ray(origin, target - origin)});
+    }
+
+    // Rays from near the center of the mesh through every corner and two points of every edge.
+    vector<ray> seams;
+    for(const array<point3, 3>& v : corners) {
+        for(int c = 0; c < 3; c++) {
+            point3 origin(0.01 * (rng.next_double() - 0.5), 0.01 * (rng.next_double() - 0.5), 0.01 * (rng.next_double() - 0.5));
+            const point3& p = v[c];
+            const point3& q = v[(c + 1) % 3];
+            seams.push_back(ray(origin, p - origin));
+            seams.push_back(ray(origin, 0.5 * (p + q) - origin));
+            seams.push_back(ray(origin, p + 0.3 * (q - p) - origin));
+        }
+    }
+
+    vector<ray> rays = random_rays(tree.bounds(), 200000);
+
+    cout << "\n== Legacy vs watertight triangle kernel ==\n";
+    cout << left << setw(16) << "kernel" << setw(14) << "Mtests/s" << setw(12) << "hit rate" << setw(16) << "traced Mrays/s"
+         << "seam misses\n";
+
+    const char* labels[2] = {"legacy", "watertight"};
+    for(int k = 0; k < 2; k++) {
+        int hits = 0;
+        double t;
+        auto start = chrono::steady_clock::now();
+        for(const auto& [f, r] : pairs) hits += kernel(k, f, r, interval(0.001, infinity), t);
+        chrono::duration<double> raw = chrono::steady_clock::now() - start;
+
+        auto trace = [&](const ray& r) {
+            return tree.traverse(r, interval(0.001, infinity), [&](uint32_t p, interval& range) {
+                double t_hit;
+                if(!kernel(k, tree.prim_indices[p], r, range, t_hit)) return false;
+                range.max = t_hit;
+                return true;
+            });
+        };
+        start = chrono::steady_clock::now();
+        int traced = 0;
+        for(const ray& r : rays) traced += trace(r);
+        chrono::duration<double> traversal = chrono::steady_clock::now() - start;
+
+        int misses = 0;
+        for(const ray& r : seams) misses += !trace(r);
+
+        cout << setw(16) << labels[k] << setw(14) << pairs.size() / raw.count() / 1e6
+             << setw(12) << double(hits) / pairs.size() << setw(16) << rays.size() / traversal.count() / 1e6
+             << misses << " of " << seams.size() << "\n";
+    }
+}
+
+/// @brief Compare object splits against spatial splits (SBVH) on the sample meshes and a stress mesh.
+void bench_sbvh() {
+    material_table materials;
+    const material* mat = materials.add<lambertian>(color(0.5, 0.5, 0.5));
+    vector<pair<string, vector<triangle>>> meshes;
+    for(string path : {cat_path, string("../input/icosahedron.obj"), string("../input/icosahedron_with_normals.obj")}) {
+        obj mesh(path, mat);
+        meshes.push_back({path.substr(path.find_last_of('/') + 1), mesh.get_triangle_faces()});
+    }
+    meshes.push_back({"slivers", diagonal_slivers(5000, mat)});
+
+    cout << "\n== Object splits vs spatial splits (SBVH) ==\n";
+    cout << left << setw(34) << "mesh" << setw(8) << "split" << setw(10) << "SAH cost" << setw(10) << "refs"
+         << setw(10) << "build ms" << setw(12) << "nodes/ray" << setw(12) << "prims/ray" << "Mrays/s\n";
+
+    for(auto& [name, faces] : meshes) {
+        vector<shared_ptr<hittable>> objects;
+        for(const triangle& face : faces) objects.push_back(make_shared<triangle>(face));
+
+        auto start = chrono::steady_clock::now();
+        auto object_split = make_shared<flat_bvh>(objects);
+        chrono::duration<double> object_time = chrono::steady_clock::now() - start;
+        start = chrono::steady_clock::now();
+        auto spatial_split = make_spatial_bvh(faces);
+        chrono::duration<double> spatial_time = chrono::steady_clock::now() - start;
+
+        vector<ray> rays = random_rays(object_split->bounding_box(), 50000);
+        const flat_bvh* layouts[2] = {object_split.get(), spatial_split.get()};
+        const char* labels[2] = {"object", "spatial"};
+        double times[2] = {object_time.count(), spatial_time.count()};
+        int hits[2];
+        for(int k = 0; k < 2; k++) {
+            const bvh_tree& tree = layouts[k]->get_tree();
+            thread_traversal_stats() = traversal_stats();
+            double speed = mrays_per_second(*layouts[k], rays, hits[k]);
+            traversal_stats stats = thread_traversal_stats();
+
+            cout << setw(34) << (name + " " + to_string(faces.size())) << setw(8) << labels[k] << setw(10) << tree.sah_cost()
+                 << setw(10) << double(tree.prim_indices.size()) / faces.size() << setw(10) << times[k] * 1000
+                 << setw(12) << double(stats.nodes_visited) / rays.size()
+                 << setw(12) << double(stats.primitives_tested) / rays.size() << speed << "\n";
+        }
+        if(hits[0] != hits[1]) cout << "(hit count mismatch!)\n";
+    }
+}
+
+/// @brief Compare closest-hit queries against occlusion queries on shadow rays.
+/// Shadow rays are segments between random points around and inside a scene, like
+/// rays from surface points towards lights, with the interval ending at the light.
+void bench_shadow() {
+    material_table materials;
+    const material* mat = materials.add<lambertian>(color(0.5, 0.5, 0.5));
+    vector<pair<string, vector<shared_ptr<hittable>>>> scenes;
+    scenes.push_back({"sphere 25600", sphere_mesh(80, 160, mat)});
+
+    obj cat(cat_path, mat);
+    vector<shared_ptr<hittable>> cat_triangles;
+    for(triangle t : cat.get_triangle_faces())
+        cat_triangles.push_back(make_shared<triangle>(t));
+    scenes.push_back({"cat.obj " + to_string(cat_triangles.size()), cat_triangles});
+
+    cout << "\n== Closest hit vs occlusion on shadow rays (Mrays/s) ==\n";
+    cout << left << setw(16) << "scene" << setw(10) << "layout" << setw(12) << "occluded" << setw(12) << "hit"
+         << setw(12) << "occluded()" << "speedup\n";
+
+    for(auto& [name, objects] : scenes) {
+        hittable_list list;
+        for(auto& object : objects) list.add(object);
+        bvh_node pointer_bvh(objects);
+        flat_bvh binary(objects);
+        wide_bvh wide(objects);
+
+        // random_rays aims from outside the box to its inside; the light end is the target point.
+        vector<ray> rays = random_rays(list.bounding_box(), 50000);
+        interval segment(0.001, 1 - 1e-3);
+
+        const hittable* layouts[4] = {&list, &pointer_bvh, &binary, &wide};
+        const char* labels[4] = {"list", "pointer", "binary", "4-wide"};
+        for(int k = 0; k < 4; k++) {
+            vector<ray> subset(rays.begin(), rays.begin() + (k == 0 ? 2000 : rays.size()));
+
+            hit_record rec;
+            int hits = 0, blocked = 0;
+            auto start = chrono::steady_clock::now();
+            for(const ray& r : subset) hits += layouts[k]->hit(r, segment, rec);
+            chrono::duration<double> closest = chrono::steady_clock::now() - start;
+
+            start = chrono::steady_clock::now();
+            for(const ray& r : subset) blocked += layouts[k]->occluded(r, segment);
+            chrono::duration<double> any = chrono::steady_clock::now() - start;
+
+            cout << setw(16) << name << setw(10) << labels[k] << setw(12) << double(blocked) / subset.size()
+                 << setw(12) << subset.size() / closest.count() / 1e6 << setw(12) << subset.size() / any.count() / 1e6
+                 << closest.count() / any.count() << "x" << (hits != blocked ? "  (mismatch!)" : "") << "\n";
+        }
+    }
+}
+
+/// @brief Compare adaptive sampling against fixed sampling at equal error. Error against a
+/// high sample reference falls like 1 / sqrt(samples) for fixed sampling, so the fixed render
+/// closest in error gives the samples fixed sampling needs to match each adaptive render.
+void bench_adaptive() {
+    material_table materials;
+    scene world = render_world(materials);
+    double seconds;
+
+    // The reference uses its own seed, so its noise is independent from the renders measured.
+    film reference = render_film(render_camera(4096, 99), world, seconds);
+
+    vector<pair<double, double>> fixed; // Samples per pixel and error of each fixed render.
+    cout << "\n== Adaptive vs fixed sampling at equal error ==\n";
+    cout << left << setw(12) << "mode" << setw(14) << "samples/px" << setw(12) << "error" << setw(10) << "seconds"
+         << "fixed samples/px at same error\n";
+    for(int samples : {4, 8, 16, 32, 64}) {
+        film f = render_film(render_camera(samples, 1), world, seconds);
+        fixed.push_back({samples, gamma_rmse(f, reference)});
+        cout << setw(12) << "fixed" << setw(14) << samples << setw(12) << fixed.back().second << seconds << "\n";
+    }
+
+    for(int samples : {16, 32}) {
+        camera cam = render_camera(samples, 1);
+        cam.adaptive = true;
+        film f = render_film(cam, world, seconds);
+        double mean_samples = std::accumulate(f.samples.begin(), f.samples.end(), 0.0) / f.samples.size();
+        double error = gamma_rmse(f, reference);
+
+        auto closest = *min_element(fixed.begin(), fixed.end(), [&](const auto& a, const auto& b) {
+            return fabs(log(a.second / error)) < fabs(log(b.second / error));
+        });
+        double needed = closest.first * (closest.second / error) * (closest.second / error);
+        cout << setw(12) << "adaptive" << setw(14) << mean_samples << setw(12) << error << setw(10) << seconds
+             << needed << " (" << needed / mean_samples << "x)\n";
+    }
+}
+
+/// @brief Measure how the tiled render scales with the threads of its pool, against one thread.
+/// Rows with more threads than the host has hardware threads are not run.
+void bench_threads() {
+    material_table materials;
+    scene world = render_world(materials);
+    const int samples = 64;
+    int hardware = max(1, int(thread::hardware_concurrency()));
+
+    cout << "\n== Render threads (" << samples << " samples per pixel, " << hardware << " hardware threads) ==\n";
+    cout << left << setw(10) << "threads" << setw(10) << "seconds" << setw(12) << "Mpaths/s" << "speedup\n";
+
+    vector<int> thread_counts = {1, 2, 4, 8, 16, 32};
+    if(hardware > 32) thread_counts.push_back(hardware);
+    double single = 0;
+    for(int threads : thread_counts) {
+        if(threads > hardware) {
+            cout << setw(10) << threads << "unmeasured (needs " << threads << " hardware threads)\n";
+            continue;
+        }
+        camera cam = render_camera(samples, 1);
+        cam.num_threads = threads;
+        double seconds;
+        film f = render_film(cam, world, seconds);
+        if(threads == 1) single = seconds;
+
+        double paths = std::accumulate(f.samples.begin(), f.samples.end(), 0.0);
+        cout << setw(10) << threads << setw(10) << seconds << setw(12) << paths / seconds / 1e6
+             << single / seconds << "x\n";
+    }
+}
+
+/// @brief Compare the wavefront integrator against the recursive (per-path) one on the same render.
+/// Both draw every sample from the same stream, so the films should match up to rounding.
+void bench_wavefront() {
+    material_table materials;
+    scene world = render_world(materials);
+    const int samples = 64;
+
+    cout << "\n== Wavefront vs per-path integrator (" << samples << " samples per pixel) ==\n";
+    cout << left << setw(12) << "integrator" << setw(10) << "seconds" << setw(12) << "Mpaths/s" << "error vs per-path\n";
+
+    film per_path;
+    for(bool wavefront : {false, true}) {
+        camera cam = render_camera(samples, 1);
+        cam.wavefront = wavefront;
+        double seconds;
+        film f = render_film(cam, world, seconds);
+        if(!wavefront) per_path = f;
+
+        double paths = std::accumulate(f.samples.begin(), f.samples.end(), 0.0);
+        cout << setw(12) << (wavefront ? "wavefront" : "per-path") << setw(10) << seconds
+             << setw(12) << paths / seconds / 1e6 << gamma_rmse(f, per_path) << "\n";
+    }
+}
+
+/// @brief Trace paths of up to four bounces through a world of spheres shared by all threads.
+/// Every closer hit found takes a handle to its material, like the hit records of ray_color do.
+/// @tparam handle const material* for material_table handles, shared_ptr<material> for the
+/// owning handles hit records held before, whose reference count every thread updates.
+/// @param tree Hierarchy over the spheres.
+/// @param spheres Spheres.
+/// @param handles Material handle of each sphere.
+/// @param rays Camera rays.
+/// @param begin First ray to trace.
+/// @param end Ray after the last one to trace.
+/// @return Number of bounces.
+template <class handle>
+size_t trace_shared_world(const bvh_tree& tree, const vector<sphere>& spheres, const vector<handle>& handles,
+                          const vector<ray>& rays, size_t begin, size_t end) {
+    size_t bounces = 0;
+    for(size_t i = begin; i < end; i++) {
+        ray r = rays[i];
+        for(int depth = 0; depth < 4; depth++) {
+            hit_record rec;
+            handle mat{};
+            bool hit = tree.traverse(r, interval(0.001, infinity), [&](uint32_t p, interval& t) {
+                uint32_t s = tree.prim_indices[p];
+                if(!spheres[s].intersect(r, t, rec)) return false;
+                mat = handles[s];
+                t.max = rec.t;
+                return true;
+            });
+            if(!hit) break;
+
+            rec.object->finalize(r, rec);
+            color attenuation;
+            ray scattered;
+            if(!mat->scatter(r, rec, attenuation, scattered)) break;
+            r = scattered;
+            bounces++;
+        }
+    }
+    return bounces;
+}
+
+/// @brief Measure how the material handle of hit records scales with render threads.
+/// All threads trace paths through the same world and share its three materials, either
+/// as plain pointers into the material table or as shared_ptrs, whose reference counts sit
+/// on a few cache lines that every thread writes. Rows with more render threads than the
+/// host has hardware threads are not run: threads that share a core don't contend.
+void bench_contention() {
+    material_table materials;
+    vector<const material*> table_mats;
+    vector<shared_ptr<material>> shared_mats;
+    for(int m = 0; m < 3; m++) {
+        color albedo(0.3 + 0.2 * m, 0.5, 0.7 - 0.2 * m);
+        table_mats.push_back(materials.add<lambertian>(albedo));
+        shared_mats.push_back(make_shared<lambertian>(albedo));
+    }
+
+    pcg32 rng(5, 3);
+    vector<sphere> spheres;
+    vector<const material*> raw_handles;
+    vector<shared_ptr<material>> shared_handles;
+    vector<aabb> boxes;
+    for(int i = 0; i < 2000; i++) {
+        point3 center(rng.next_double() * 4 - 2, rng.next_double() * 4 - 2, rng.next_double() * 4 - 2);
+        spheres.push_back(sphere(center, 0.1 + 0.2 * rng.next_double(), table_mats[i % 3]));
+        raw_handles.push_back(table_mats[i % 3]);
+        shared_handles.push_back(shared_mats[i % 3]);
+        boxes.push_back(spheres.back().bounding_box());
+    }
+    bvh_tree tree;
+    tree.build(boxes);
+    vector<ray> rays = random_rays(tree.bounds(), 200000);
+
+    // Split the rays evenly between the threads and return millions of paths per second.
+    auto run = [&](int threads, auto trace) {
+        vector<thread> pool;
+        auto start = chrono::steady_clock::now();
+        for(int t = 0; t < threads; t++)
+            pool.emplace_back(trace, rays.size() * t / threads, rays.size() * (t + 1) / threads);
+        for(thread& worker : pool) worker.join();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        return rays.size() / elapsed.count() / 1e6;
+    };
+
+    int hardware = max(1, int(thread::hardware_concurrency()));
+    cout << "\n== Material handles in a shared-world render (" << hardware << " hardware threads) ==\n";
+    cout << left << setw(10) << "threads" << setw(16) << "table Mpaths/s" << setw(22) << "shared_ptr Mpaths/s"
+         << "ratio\n";
+
+    for(int threads : {1, 8, 32, 64}) {
+        if(threads > hardware) {
+            cout << setw(10) << threads << "unmeasured (needs " << threads << " hardware threads)\n";
+            continue;
+        }
+        double raw = run(threads, [&](size_t begin, size_t end) {
+            trace_shared_world(tree, spheres, raw_handles, rays, begin, end);
+        });
+        double shared = run(threads, [&](size_t begin, size_t end) {
+            trace_shared_world(tree, spheres, shared_handles, rays, begin, end);
+        });
+        cout << setw(10) << threads << setw(16) << raw << setw(22) << shared << raw / shared << "x\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    map<string, function<void()>> sections = {
+        {"adaptive", bench_adaptive},
+        {"build", bench_build},
+        {"contention", bench_contention},
+        {"deferred", bench_deferred},
+        {"dispatch", bench_dispatch},
+        {"bvh", bench_bvh},
+        {"instances", bench_instances},
+        {"layout", bench_layout},
+        {"mesh", bench_mesh},
+        {"quantized", bench_quantized},
+        {"refit", bench_refit},
+        {"sbvh", bench_sbvh},
+        {"threads", bench_threads},
+        {"triangle", bench_triangle},
+        {"shadow", bench_shadow},
+        {"wavefront", bench_wavefront},
+        {"wide", bench_wide},
+    };
+
+    cout << setprecision(4);
+    if(argc == 1) {
+        for(auto& [name, run] : sections) run();
+        return 0;
+    }
+
+    for(int i = 1; i < argc; i++) {
+        auto section = sections.find(argv[i]);
+        if(section == sections.end()) {
+            clog << "> Unknown benchmark " << argv[i] << "!\n";
+            return 1;
+        }
+        section->second();
+    }
+}
@@ -1,25 +1,28 @@
 #include "../include/obj.hpp"
 #include "../include/sphere.hpp"
 #include "../include/triangle.hpp"
-#include "../include/hittable_list.hpp"
+#include "../include/scene.hpp"
 #include "../include/camera.hpp"
 #include "../include/material.hpp"
 
 int main() {
-    // World
-    hittable_list world;
+    // World, its objects point into the material table, which outlives the render.
+    material_table materials;
+    scene world;
 
-    auto material_ground = make_shared<lambertian>(color(0.8, 0.8, 0.0));
-    auto material_sphere = make_shared<dielectric>(1.5);
-    auto material_ico = make_shared<metal>(color(0.8, 0.6, 0.2), 0.0);
+    auto material_ground = materials.add<lambertian>(color(0.8, 0.8, 0.0));
+    auto material_sphere = materials.add<dielectric>(1.5);
+    auto material_ico = materials.add<metal>(color(0.8, 0.6, 0.2), 0.0);
 
-    world.add(make_shared<sphere>(point3(0.0, -101, -1.0), 100.0, material_ground));
-    world.add(make_shared<sphere>(point3(2, 0.0, 0), 1, material_sphere));
+    world.add(sphere(point3(0.0, -101, -1.0), 100.0, material_ground));
+    world.add(sphere(point3(2, 0.0, 0), 1, material_sphere));
 
-    obj ico = obj("../input/icosahedron.obj", material_ico);
-    for(triangle t : ico.get_triangle_faces()) {
-        world.add(make_shared<triangle>(t));
-    }
+    // The mesh keeps its own hierarchy over its faces.
+    auto ico_mesh = obj::load_triangle_mesh("../input/icosahedron.obj", material_ico);
+    world.add(ico_mesh);
+
+    // One hierarchy over the spheres, stored by value, and the mesh.
+    world.build();
 
     // Camera
     camera cam1;
@@ -32,7 +35,6 @@ int main() {
     cam1.look_from = point3(1, 0, 2);
     cam1.look_at = point3(1, 0, 0);
     cam1.v_up = vec3(0, 1, 0);
-    cam1.render(world);
 
     camera cam2;
     cam2.path = "../images/output_cam2.png";
@@ -44,5 +46,7 @@ int main() {
     cam2.look_from = point3(1.6, 1, -2);
     cam2.look_at = point3(1, 0, 0);
     cam2.v_up = vec3(0, 1, 0);
-    cam2.render(world);
+
+    // Render both views at once on a shared thread pool.
+    camera::render_batch({&cam1, &cam2}, world);
 }
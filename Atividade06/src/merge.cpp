@@ -0,0 +1,46 @@
+/*!
+ * \file Tool that assembles the films of partial (cropped) renders into the full image.
+ */
+
+#include "../include/film.hpp"
+
+int main(int argc, char** argv) {
+    if(argc < 3) {
+        clog << "> Usage: merge <output.png> <part.film> [<part.film> ...]\n";
+        return 1;
+    }
+
+    film full;
+    uint64_t full_seed = 0;
+
+    for(int n = 2; n < argc; ++n) {
+        film part;
+        uint64_t seed;
+        if(!part.read(argv[n], seed)) {
+            clog << "> Error reading film " << argv[n] << "!\n";
+            return 1;
+        }
+
+        // The first part decides the frame every other part must belong to.
+        if(n == 2) {
+            full.reset(part.full_width, part.full_height);
+            full_seed = seed;
+        }
+
+        if(seed != full_seed || part.full_width != full.width || part.full_height != full.height ||
+           !full.paste(part)) {
+            clog << "> Film " << argv[n] << " is not part of the same frame!\n";
+            return 1;
+        }
+    }
+
+    // Pixels covered by no part have no samples and stay black.
+    int missing = 0;
+    for(int count : full.samples)
+        missing += (count == 0);
+    if(missing > 0)
+        clog << "> Warning: " << missing << " pixels were not covered by any part\n";
+
+    full.save(argv[1]);
+    clog << "\rMerged image saved at " << argv[1] << endl;
+}
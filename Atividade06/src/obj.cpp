@@ -4,7 +4,9 @@
 
 #include "../include/obj.hpp"
 
-obj::obj(string path, shared_ptr<material> _mat) : mat(_mat) {
+#include <cstdlib>
+
+obj::obj(string path, const material* _mat) : mat(_mat) {
     if(path.substr(path.size() - 4, 4) != ".obj") {
         clog << "> File from this path is not in .obj format!\n";
         exit(1);
@@ -179,6 +181,114 @@ vector<triangle> obj::get_triangle_faces() {
     return triangle_list;
 }
 
+shared_ptr<hittable_list> obj::get_mesh() {
+    auto mesh = make_shared<hittable_list>();
+    for(triangle t : get_triangle_faces()) {
+        mesh->add(make_shared<triangle>(t));
+    }
+    return mesh;
+}
+
+shared_ptr<triangle_mesh> obj::get_triangle_mesh() {
+    vector<point3> positions(v_vec.begin(), v_vec.end());
+    vector<array<uint32_t, 3>> faces, normal_faces;
+    faces.reserve(f_vec.size());
+    if(!vn_vec.empty()) normal_faces.reserve(f_vec.size());
+
+    // Like get_triangle_faces, each face uses its first three vertices
+    // and OBJ indices start at 1.
+    for(const vector<array<int, 3>>& face : f_vec) {
+        faces.push_back({uint32_t(face[0][0] - 1), uint32_t(face[1][0] - 1), uint32_t(face[2][0] - 1)});
+        if(!vn_vec.empty())
+            normal_faces.push_back({uint32_t(face[0][2] - 1), uint32_t(face[1][2] - 1), uint32_t(face[2][2] - 1)});
+    }
+
+    return make_shared<triangle_mesh>(std::move(positions), vn_vec, std::move(faces), std::move(normal_faces), mat);
+}
+
+shared_ptr<triangle_mesh> obj::load_triangle_mesh(const string& path, const material* _mat) {
+    if(path.size() < 4 || path.substr(path.size() - 4, 4) != ".obj") {
+        clog << "> File from this path is not in .obj format!\n";
+        exit(1);
+    }
+
+    ifstream file(path);
+    if(!file.is_open()) {
+        clog << "> Error opening file!\n";
+        exit(1);
+    }
+
+    vector<point3> positions;
+    vector<vec3> normals;
+    vector<array<uint32_t, 3>> faces, normal_faces;
+    vector<uint32_t> corners, normal_corners; // Of the face being read.
+    bool every_normal = true;
+
+    // OBJ indices start at 1 and negative ones count back from the last element read so far.
+    // A missing index (0) resolves past the end and fails the mesh's range check.
+    auto resolve_index = [](long index, size_t count) {
+        return uint32_t(index > 0 ? index - 1 : long(count) + index);
+    };
+
+    string line;
+    while(getline(file, line)) {
+        const char* s = line.c_str();
+        char* end;
+
+        // Geometric vertices and vertex normals
+        if(s[0] == 'v' && (s[1] == ' ' || (s[1] == 'n' && s[2] == ' '))) {
+            double x = strtod(s + 2, &end);
+            double y = strtod(end, &end);
+            double z = strtod(end, &end);
+            if(s[1] == ' ') positions.push_back(point3(x, y, z));
+            else normals.push_back(vec3(x, y, z));
+        }
+
+        // Face elements, as v, v/vt, v//vn or v/vt/vn, with any number of corners
+        if(s[0] == 'f' && s[1] == ' ') {
+            corners.clear();
+            normal_corners.clear();
+
+            const char* p = s + 2;
+            while(true) {
+                long v = strtol(p, &end, 10), vn = 0;
+                if(end == p) break;
+                p = end;
+                if(*p == '/') {
+                    strtol(p + 1, &end, 10);
+                    p = end;
+                    if(*p == '/') {
+                        vn = strtol(p + 1, &end, 10);
+                        p = end;
+                    }
+                }
+                corners.push_back(resolve_index(v, positions.size()));
+                normal_corners.push_back(resolve_index(vn, normals.size()));
+                every_normal = every_normal && vn != 0;
+            }
+
+            // Polygons are split in a fan of triangles around their first corner.
+            for(size_t k = 1; k + 1 < corners.size(); k++) {
+                faces.push_back({corners[0], corners[k], corners[k + 1]});
+                if(every_normal) normal_faces.push_back({normal_corners[0], normal_corners[k], normal_corners[k + 1]});
+            }
+        }
+    }
+
+    // Shade with the face normals unless every corner has a normal.
+    if(normals.empty() || !every_normal) {
+        normals.clear();
+        normal_faces.clear();
+    }
+    positions.shrink_to_fit();
+    normals.shrink_to_fit();
+    faces.shrink_to_fit();
+    normal_faces.shrink_to_fit();
+
+    return make_shared<triangle_mesh>(std::move(positions), std::move(normals), std::move(faces),
+                                      std::move(normal_faces), _mat);
+}
+
 array<int, 3> obj::parse_face_ind(string ind_list) {
     array<int, 3> indices;
     stringstream ss(ind_list);
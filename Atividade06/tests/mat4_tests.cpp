@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include "../include/mat4.hpp"
+#include "../include/vec4.hpp"
+
+namespace {
+    // mat4's operator== allows an error of 0.1, too loose for an inverse.
+    void expect_identity(const mat4& a) {
+        for(int i = 0; i < 4; i++) {
+            for(int j = 0; j < 4; j++) {
+                EXPECT_NEAR(a.e[i][j], (i == j) ? 1 : 0, 1e-12) << "at " << i << ", " << j;
+            }
+        }
+    }
+
+    TEST(mat4_tests, inverse) {
+        mat4 a = mat4(1.777, 2, -4.4, 2,
+                        20, -4, 12.3, 3,
+                        -3, 2.15, 32, -2,
+                        1, 2, 8, 5.4);
+
+        expect_identity(a * a.inverse());
+        expect_identity(a.inverse() * a);
+    }
+
+    TEST(mat4_tests, inverse_transform) {
+        // Rotation about z by 30 degrees, scale and translation, like an instance's transform.
+        double angle = acos(-1.0) / 6;
+        double c = cos(angle), s = sin(angle);
+        mat4 a = mat4(2 * c, -3 * s, 0, 1.5,
+                        2 * s, 3 * c, 0, -2,
+                        0, 0, 0.5, 4,
+                        0, 0, 0, 1);
+        mat4 expect = mat4(c / 2, s / 2, 0, -(1.5 * c - 2 * s) / 2,
+                            -s / 3, c / 3, 0, (1.5 * s + 2 * c) / 3,
+                            0, 0, 2, -8,
+                            0, 0, 0, 1);
+
+        mat4 inv = a.inverse();
+        for(int i = 0; i < 4; i++) {
+            for(int j = 0; j < 4; j++) {
+                EXPECT_NEAR(inv.e[i][j], expect.e[i][j], 1e-12) << "at " << i << ", " << j;
+            }
+        }
+        expect_identity(a * inv);
+    }
+
+    TEST(mat4_tests, inverse_needs_pivoting) {
+        // Zeros on the diagonal, elimination without row swaps would divide by zero.
+        mat4 a = mat4(0, 2, 0, 0,
+                        0, 0, 0, -1,
+                        3, 0, 0, 0,
+                        0, 0, 4, 0);
+        mat4 expect = mat4(0, 0, 1.0 / 3, 0,
+                            0.5, 0, 0, 0,
+                            0, 0, 0, 0.25,
+                            0, -1, 0, 0);
+
+        EXPECT_EQ(a.inverse(), expect);
+        expect_identity(a * a.inverse());
+    }
+
+    TEST(mat4_tests, inverse_of_singular) {
+        // The last row is the sum of the first two.
+        mat4 a = mat4(1, 2, 3, 4,
+                        5, 6, 7, 8,
+                        2, 0, 1, 3,
+                        6, 8, 10, 12);
+        mat4 zero = mat4();
+
+        EXPECT_NEAR(a.det(), 0, 1e-9);
+        mat4 inv = a.inverse();
+        for(int i = 0; i < 4; i++) {
+            for(int j = 0; j < 4; j++) {
+                EXPECT_EQ(inv.e[i][j], zero.e[i][j]) << "at " << i << ", " << j;
+            }
+        }
+    }
+}